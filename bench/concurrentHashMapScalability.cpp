@@ -0,0 +1,139 @@
+//Scalability stress benchmark for stevensMapLib::ConcurrentHashMap.
+//
+//Runs a fixed mix of lookups, overwrites, inserts and erases over a shared map from 1, 2, 4, ... up to 64 threads, and reports
+//throughput, speedup over one thread, and how much retired memory is waiting for readers, which should stay bounded however
+//long the run is.
+//
+//Build:  g++ -std=c++20 -O2 -pthread -I.. concurrentHashMapScalability.cpp -o concurrentHashMapScalability
+//Usage:  ./concurrentHashMapScalability [secondsPerStep] [keyCount] [writePercent]
+
+#include "stevensMapLib.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    //Keeps the lookups from being optimized away
+    std::atomic<std::uint64_t> checksumSink{0};
+
+    struct StepResult
+    {
+        double operationsPerSecond;
+        std::size_t pendingReclamation;
+        std::size_t size;
+    };
+
+    //A small xorshift generator per thread, so the benchmark measures the map rather than a shared random number generator
+    std::uint64_t nextRandom(   std::uint64_t & state   )
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    StepResult runStep( stevensMapLib::ConcurrentHashMap<std::uint64_t,std::uint64_t> & map,
+                        unsigned threadCount,
+                        double seconds,
+                        std::uint64_t keyCount,
+                        unsigned writePercent   )
+    {
+        std::atomic<bool> start{false};
+        std::atomic<bool> stop{false};
+        std::vector<std::uint64_t> operations(threadCount * 8, 0);
+        std::vector<std::thread> threads;
+        for(unsigned t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back([&, t]
+            {
+                std::uint64_t state = 0x9E3779B97F4A7C15ull * (t + 1);
+                std::uint64_t done = 0;
+                std::uint64_t checksum = 0;
+                while(!start.load(std::memory_order_acquire))
+                {
+                    std::this_thread::yield();
+                }
+                while(!stop.load(std::memory_order_relaxed))
+                {
+                    for(int i = 0; i < 256; i++)
+                    {
+                        std::uint64_t random = nextRandom(state);
+                        std::uint64_t key = random % keyCount;
+                        unsigned roll = static_cast<unsigned>((random >> 32) % 100);
+                        if(roll >= writePercent)
+                        {
+                            checksum += map.find(key).value_or(0);
+                        }
+                        else if(roll % 4 == 0)
+                        {
+                            map.erase(key);
+                        }
+                        else
+                        {
+                            map.insert_or_assign(key, random);
+                        }
+                    }
+                    done += 256;
+                }
+                //Padded so threads don't share a cache line while counting
+                operations[t * 8] = done;
+                checksumSink.fetch_add(checksum, std::memory_order_relaxed);
+            });
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        start.store(true, std::memory_order_release);
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        stop.store(true, std::memory_order_relaxed);
+        for(std::thread & thread : threads)
+        {
+            thread.join();
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        std::uint64_t total = 0;
+        for(unsigned t = 0; t < threadCount; t++)
+        {
+            total += operations[t * 8];
+        }
+        return { total / elapsed, map.pendingReclamation(), map.size() };
+    }
+}
+
+int main(   int argc,
+            char * argv[]   )
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 1.0;
+    std::uint64_t keyCount = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+    unsigned writePercent = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 10;
+    if(seconds <= 0 || keyCount == 0 || writePercent > 100)
+    {
+        std::fprintf(stderr, "usage: %s [secondsPerStep > 0] [keyCount > 0] [writePercent 0-100]\n", argv[0]);
+        return 1;
+    }
+
+    stevensMapLib::ConcurrentHashMap<std::uint64_t,std::uint64_t> map;
+    for(std::uint64_t key = 0; key < keyCount; key += 2)
+    {
+        map.insert_or_assign(key, key);
+    }
+
+    std::printf("keys: %llu, writes: %u%%, hardware threads: %u\n", static_cast<unsigned long long>(keyCount), writePercent, std::thread::hardware_concurrency());
+    std::printf("%8s %16s %10s %20s %12s\n", "threads", "ops/s", "speedup", "pending reclamation", "size");
+    double baseline = 0;
+    for(unsigned threadCount = 1; threadCount <= 64; threadCount *= 2)
+    {
+        StepResult result = runStep(map, threadCount, seconds, keyCount, writePercent);
+        if(threadCount == 1)
+        {
+            baseline = result.operationsPerSecond;
+        }
+        std::printf("%8u %16.0f %9.2fx %20zu %12zu\n", threadCount, result.operationsPerSecond, result.operationsPerSecond / baseline, result.pendingReclamation, result.size);
+    }
+    return 0;
+}
@@ -6,538 +6,8444 @@
 
 #include "stevensStringLib.h"
 #include <iterator>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <compare>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <ostream>
+#include <random>
+#include <ranges>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #ifndef STEVENSMAPLIB
 #define STEVENSMAPLIB
 
+//Define STEVENSMAPLIB_INSTRUMENTATION before including this header to record call counts, elements scanned, estimated bytes
+//allocated, and latency for the library's functions. Without it, the hooks below expand to nothing.
+#ifdef STEVENSMAPLIB_INSTRUMENTATION
+#define STEVENSMAPLIB_INSTRUMENT(functionName) \
+    static ::stevensMapLib::instrumentation::FunctionStats stevensMapLibStats_(functionName); \
+    ::stevensMapLib::instrumentation::ScopedCall stevensMapLibCall_(stevensMapLibStats_)
+#define STEVENSMAPLIB_RECORD_SCANNED(count) stevensMapLibCall_.scanned(count)
+#define STEVENSMAPLIB_RECORD_ALLOCATED(container) stevensMapLibCall_.allocated(::stevensMapLib::instrumentation::estimatedBytes(container))
+#else
+#define STEVENSMAPLIB_INSTRUMENT(functionName)
+#define STEVENSMAPLIB_RECORD_SCANNED(count)
+#define STEVENSMAPLIB_RECORD_ALLOCATED(container)
+#endif
+
+namespace stevensMapLib
+{
+    /*** Instrumentation ***/
+    namespace instrumentation
+    {
+        /**
+         * @brief A latency histogram with log-linear buckets, in the style of HdrHistogram. Each power of two range of
+         *        nanoseconds is split into SubBucketCount equal buckets, so any recorded latency is reported to within
+         *        1/SubBucketCount of its true value while the whole 64-bit range fits in a fixed array of counters.
+         */
+        class LatencyHistogram
+        {
+            public:
+                static constexpr unsigned SubBucketBits = 4;
+                static constexpr std::size_t SubBucketCount = std::size_t(1) << SubBucketBits;
+                static constexpr std::size_t BucketCount = (64 - SubBucketBits + 1) * SubBucketCount;
+
+                /**
+                 * @brief The bucket a latency of nanoseconds is counted in.
+                 */
+                static constexpr std::size_t bucketIndex(   std::uint64_t nanoseconds   ) noexcept
+                {
+                    if(nanoseconds < SubBucketCount)
+                    {
+                        return nanoseconds;
+                    }
+                    unsigned magnitude = std::bit_width(nanoseconds) - SubBucketBits;
+                    return magnitude * SubBucketCount + ((nanoseconds >> (magnitude - 1)) & (SubBucketCount - 1));
+                }
+
+                /**
+                 * @brief The smallest latency counted in a bucket.
+                 */
+                static constexpr std::uint64_t bucketLowerBound(    std::size_t index   ) noexcept
+                {
+                    if(index < SubBucketCount)
+                    {
+                        return index;
+                    }
+                    std::size_t magnitude = index / SubBucketCount;
+                    return (SubBucketCount + index % SubBucketCount) << (magnitude - 1);
+                }
+
+                /**
+                 * @brief The largest latency counted in a bucket.
+                 */
+                static constexpr std::uint64_t bucketUpperBound(    std::size_t index   ) noexcept
+                {
+                    return index + 1 < BucketCount ? bucketLowerBound(index + 1) - 1 : UINT64_MAX;
+                }
+
+                void record(    std::uint64_t nanoseconds   ) noexcept
+                {
+                    m_counts[bucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+                    m_sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+                    std::uint64_t max = m_max.load(std::memory_order_relaxed);
+                    while(nanoseconds > max && !m_max.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed)) {}
+                }
+
+                std::uint64_t countAt(  std::size_t index   ) const noexcept { return m_counts[index].load(std::memory_order_relaxed); }
+                std::uint64_t sum() const noexcept { return m_sum.load(std::memory_order_relaxed); }
+                std::uint64_t max() const noexcept { return m_max.load(std::memory_order_relaxed); }
+
+                void reset() noexcept
+                {
+                    for(auto & count : m_counts)
+                    {
+                        count.store(0, std::memory_order_relaxed);
+                    }
+                    m_sum.store(0, std::memory_order_relaxed);
+                    m_max.store(0, std::memory_order_relaxed);
+                }
+
+            private:
+                std::array<std::atomic<std::uint64_t>, BucketCount> m_counts = {};
+                std::atomic<std::uint64_t> m_sum = 0;
+                std::atomic<std::uint64_t> m_max = 0;
+        };
+
+
+        /**
+         * @brief A point in time copy of a LatencyHistogram, which can be queried without racing the threads still recording.
+         */
+        struct HistogramSnapshot
+        {
+            std::vector<std::uint64_t> counts;
+            std::uint64_t count = 0;
+            std::uint64_t sumNanoseconds = 0;
+            std::uint64_t maxNanoseconds = 0;
+
+            /**
+             * @brief The latency that the fraction quantile of recorded calls took no longer than, e.g. quantile 0.99 is the
+             *        99th percentile. Reported as the top of the bucket the quantile falls in, capped at the largest latency seen.
+             */
+            std::uint64_t percentile(   double quantile ) const noexcept
+            {
+                if(count == 0)
+                {
+                    return 0;
+                }
+                std::uint64_t rank = quantile <= 0 ? 1 : quantile >= 1 ? count : std::uint64_t(quantile * count + 0.5);
+                rank = std::max<std::uint64_t>(rank, 1);
+                std::uint64_t seen = 0;
+                for(std::size_t i = 0; i < counts.size(); i++)
+                {
+                    seen += counts[i];
+                    if(seen >= rank)
+                    {
+                        return std::min(LatencyHistogram::bucketUpperBound(i), maxNanoseconds);
+                    }
+                }
+                return maxNanoseconds;
+            }
+
+            double mean() const noexcept
+            {
+                return count == 0 ? 0.0 : double(sumNanoseconds) / double(count);
+            }
+        };
+
+
+        struct FunctionStats;
+
+        namespace detail
+        {
+            //Every FunctionStats ever constructed, newest first. Pushing is lock free and never allocates, so registering
+            //a function's stats the first time it's called doesn't show up in its own allocation counts.
+            inline std::atomic<FunctionStats *> registryHead = nullptr;
+        }
+
+
+        /**
+         * @brief The counters kept for one instantiation of a library function. Each is a static that registers itself
+         *        when constructed, and snapshot() adds together the stats of instantiations that share a name.
+         */
+        struct FunctionStats
+        {
+            /**
+             * @param functionName The function's name, which must outlive the stats, e.g. a string literal.
+             */
+            explicit FunctionStats( std::string_view functionName   ) noexcept : name(functionName), next(detail::registryHead.load(std::memory_order_relaxed))
+            {
+                while(!detail::registryHead.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed)) {}
+            }
+
+            FunctionStats(  const FunctionStats &   ) = delete;
+            FunctionStats & operator=(  const FunctionStats &   ) = delete;
+
+            const std::string_view name;
+            FunctionStats * next;
+            std::atomic<std::uint64_t> calls = 0;
+            std::atomic<std::uint64_t> elementsScanned = 0;
+            std::atomic<std::uint64_t> bytesAllocated = 0;
+            LatencyHistogram latency;
+        };
+
+
+        /**
+         * @brief A point in time copy of a function's FunctionStats.
+         */
+        struct FunctionSnapshot
+        {
+            std::string name;
+            std::uint64_t calls = 0;
+            std::uint64_t elementsScanned = 0;
+            std::uint64_t bytesAllocated = 0;
+            HistogramSnapshot latency;
+        };
+
+
+        namespace detail
+        {
+            template <typename Visitor>
+            void forEachRegistered( Visitor && visitor  )
+            {
+                for(FunctionStats * stats = registryHead.load(std::memory_order_acquire); stats != nullptr; stats = stats->next)
+                {
+                    visitor(*stats);
+                }
+            }
+        }
+
+
+        /**
+         * @brief How many times, and for how many bytes in total, operator new was called.
+         */
+        struct AllocationStats
+        {
+            std::uint64_t allocations = 0;
+            std::uint64_t bytes = 0;
+        };
+
+
+        namespace detail
+        {
+            //Updated by the counting operator new emitted by STEVENSMAPLIB_COUNT_ALLOCATIONS_IMPLEMENTATION
+            inline thread_local AllocationStats threadAllocations;
+            inline std::atomic<bool> countingAllocatorInstalled = false;
+
+            //How many instrumented calls are running on this thread, so a library function called by another isn't counted twice
+            inline thread_local unsigned instrumentedDepth = 0;
+        }
+
+
+        /**
+         * @brief Whether one source file of the program defined STEVENSMAPLIB_COUNT_ALLOCATIONS_IMPLEMENTATION before including
+         *        this header, replacing the global operator new with one that counts allocations.
+         */
+        inline bool countingAllocatorInstalled() noexcept
+        {
+            return detail::countingAllocatorInstalled.load(std::memory_order_relaxed);
+        }
+
+
+        /**
+         * @brief The allocations made by the calling thread since it started, when the counting allocator is installed.
+         */
+        inline AllocationStats threadAllocations() noexcept
+        {
+            return detail::threadAllocations;
+        }
+
+
+        /**
+         * @brief Calls function and counts the allocations it made on the calling thread, including allocations for its return
+         *        value. Deallocations aren't subtracted, so this is the allocation traffic of the call rather than its footprint.
+         * 
+         * Example: auto stats = stevensMapLib::instrumentation::measureAllocations([&]{ return stevensMapLib::getKeyVector(map); });
+         *          //stats.allocations == 1
+         * 
+         * @throws std::logic_error if the counting allocator isn't installed, since every call would otherwise measure zero.
+         */
+        template <typename Function>
+        AllocationStats measureAllocations( Function && function    )
+        {
+            if(!countingAllocatorInstalled())
+            {
+                throw std::logic_error("stevensMapLib::measureAllocations() needs STEVENSMAPLIB_COUNT_ALLOCATIONS_IMPLEMENTATION defined in one source file");
+            }
+            AllocationStats before = detail::threadAllocations;
+            std::invoke(std::forward<Function>(function));
+            AllocationStats after = detail::threadAllocations;
+            return AllocationStats{after.allocations - before.allocations, after.bytes - before.bytes};
+        }
+
+
+        /**
+         * @brief The most allocations, and the most bytes, a call is allowed to make.
+         */
+        struct AllocationBudget
+        {
+            std::uint64_t maxAllocations = UINT64_MAX;
+            std::uint64_t maxBytes = UINT64_MAX;
+        };
+
+
+        /**
+         * @brief The declared budgets of library functions whose allocations don't depend on the size of the map, for keys and
+         *        values that don't allocate when copied (numbers, and strings short enough to be stored inline).
+         */
+        namespace budgets
+        {
+            inline constexpr AllocationBudget sumAllValues = {0};
+            inline constexpr AllocationBudget setNegativeValuesToZero = {0};
+            inline constexpr AllocationBudget getFirstKey = {0};
+            inline constexpr AllocationBudget getRandomKey = {0};
+            inline constexpr AllocationBudget getPairWithMaxValue = {0};
+            inline constexpr AllocationBudget getPairWithMaxKey = {0};
+            inline constexpr AllocationBudget getKeyVector = {1};
+            inline constexpr AllocationBudget getValueVector = {1};
+            inline constexpr AllocationBudget mapToVecOfTuples = {1};
+        }
+
+
+        /**
+         * @brief Calls function, measuring its allocations with measureAllocations(), and checks them against budget.
+         * 
+         * Example: stevensMapLib::instrumentation::checkAllocationBudget("sumAllValues", stevensMapLib::instrumentation::budgets::sumAllValues,
+         *                                                                [&]{ return stevensMapLib::sumAllValues(map); });
+         * 
+         * @param functionName The name used for the call in the error message.
+         * @return The allocations the call made.
+         * @throws std::runtime_error if the call made more allocations or allocated more bytes than budget allows.
+         */
+        template <typename Function>
+        AllocationStats checkAllocationBudget(  std::string_view functionName,
+                                                const AllocationBudget & budget,
+                                                Function && function    )
+        {
+            AllocationStats stats = measureAllocations(std::forward<Function>(function));
+            if(stats.allocations > budget.maxAllocations || stats.bytes > budget.maxBytes)
+            {
+                throw std::runtime_error("stevensMapLib::checkAllocationBudget() " + std::string(functionName) + " made " + std::to_string(stats.allocations) +
+                                         " allocations totalling " + std::to_string(stats.bytes) + " bytes, over its budget of " +
+                                         std::to_string(budget.maxAllocations) + " allocations and " + std::to_string(budget.maxBytes) + " bytes");
+            }
+            return stats;
+        }
+
+
+        /**
+         * @brief Counts a call when constructed and records its latency when destroyed, including when the call throws. When
+         *        the counting allocator is installed, the bytes the call allocated are measured instead of estimated.
+         *        Only the outermost instrumented call on a thread is recorded, so when one library function calls another,
+         *        e.g. getRandomValue() calling getRandomKey(), the work is counted once, against the function the caller called.
+         */
+        class ScopedCall
+        {
+            public:
+                explicit ScopedCall(    FunctionStats & stats   ) noexcept : m_stats(stats), m_outermost(detail::instrumentedDepth++ == 0), m_measured(countingAllocatorInstalled()),
+                                                                            m_bytesBefore(detail::threadAllocations.bytes), m_start(std::chrono::steady_clock::now())
+                {
+                    if(m_outermost)
+                    {
+                        m_stats.calls.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+
+                ScopedCall( const ScopedCall &  ) = delete;
+                ScopedCall & operator=( const ScopedCall &  ) = delete;
+
+                ~ScopedCall()
+                {
+                    detail::instrumentedDepth--;
+                    if(!m_outermost)
+                    {
+                        return;
+                    }
+                    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start);
+                    m_stats.latency.record(std::uint64_t(std::max<std::int64_t>(elapsed.count(), 0)));
+                    if(m_measured)
+                    {
+                        m_stats.bytesAllocated.fetch_add(detail::threadAllocations.bytes - m_bytesBefore, std::memory_order_relaxed);
+                    }
+                }
+
+                void scanned(   std::uint64_t count ) noexcept
+                {
+                    if(m_outermost)
+                    {
+                        m_stats.elementsScanned.fetch_add(count, std::memory_order_relaxed);
+                    }
+                }
+
+                void allocated( std::uint64_t bytes ) noexcept
+                {
+                    if(m_outermost && !m_measured)
+                    {
+                        m_stats.bytesAllocated.fetch_add(bytes, std::memory_order_relaxed);
+                    }
+                }
+
+            private:
+                FunctionStats & m_stats;
+                bool m_outermost;
+                bool m_measured;
+                std::uint64_t m_bytesBefore;
+                std::chrono::steady_clock::time_point m_start;
+        };
+
+
+        /**
+         * @brief Estimates the bytes a container holds on the heap: the element storage of a vector, or the nodes (and bucket
+         *        array) of a node-based map. Memory owned by the elements themselves, such as long string keys, isn't counted.
+         */
+        template <typename Container>
+        std::uint64_t estimatedBytes(   const Container & container )
+        {
+            using Element = typename Container::value_type;
+            if constexpr(requires { container.capacity(); })
+            {
+                return container.capacity() * sizeof(Element);
+            }
+            else if constexpr(requires { container.bucket_count(); })
+            {
+                //Each node holds the pair, a next pointer, and usually the cached hash
+                return container.size() * (sizeof(Element) + 2 * sizeof(void *)) + container.bucket_count() * sizeof(void *);
+            }
+            else
+            {
+                //Each tree node holds the pair, three links, and its color
+                return container.size() * (sizeof(Element) + 4 * sizeof(void *));
+            }
+        }
+
+
+        /**
+         * @brief Copies the stats of every function that has been called since instrumentation started, or since reset().
+         *        Empty unless STEVENSMAPLIB_INSTRUMENTATION is defined.
+         */
+        inline std::vector<FunctionSnapshot> snapshot()
+        {
+            std::vector<FunctionSnapshot> snapshots;
+            detail::forEachRegistered([&snapshots](const FunctionStats & stats)
+            {
+                auto function = std::find_if(snapshots.begin(), snapshots.end(), [&stats](const FunctionSnapshot & snapshot) { return snapshot.name == stats.name; });
+                if(function == snapshots.end())
+                {
+                    function = snapshots.insert(snapshots.end(), FunctionSnapshot());
+                    function->name = stats.name;
+                    function->latency.counts.resize(LatencyHistogram::BucketCount);
+                }
+                function->calls += stats.calls.load(std::memory_order_relaxed);
+                function->elementsScanned += stats.elementsScanned.load(std::memory_order_relaxed);
+                function->bytesAllocated += stats.bytesAllocated.load(std::memory_order_relaxed);
+                for(std::size_t i = 0; i < LatencyHistogram::BucketCount; i++)
+                {
+                    std::uint64_t count = stats.latency.countAt(i);
+                    function->latency.counts[i] += count;
+                    function->latency.count += count;
+                }
+                function->latency.sumNanoseconds += stats.latency.sum();
+                function->latency.maxNanoseconds = std::max(function->latency.maxNanoseconds, stats.latency.max());
+            });
+            //Registration is newest first, so reverse to list functions in the order they were first called
+            std::reverse(snapshots.begin(), snapshots.end());
+            return snapshots;
+        }
+
+
+        /**
+         * @brief Zeroes every function's stats, e.g. between benchmark runs.
+         */
+        inline void reset()
+        {
+            detail::forEachRegistered([](FunctionStats & stats)
+            {
+                stats.calls.store(0, std::memory_order_relaxed);
+                stats.elementsScanned.store(0, std::memory_order_relaxed);
+                stats.bytesAllocated.store(0, std::memory_order_relaxed);
+                stats.latency.reset();
+            });
+        }
+
+
+        /**
+         * @brief Writes a snapshot of every function's stats in the Prometheus text format, so it can be served from a metrics
+         *        endpoint or diffed between runs.
+         * 
+         * Example: stevensmaplib_calls_total{function="addMaps"} 12
+         *          stevensmaplib_latency_nanoseconds{function="addMaps",quantile="0.99"} 5119
+         */
+        inline std::string exportText()
+        {
+            std::string text;
+            auto appendLine = [&text](std::string_view metric, const std::string & function, std::string_view quantile, auto value)
+            {
+                text.append("stevensmaplib_").append(metric).append("{function=\"").append(function).append("\"");
+                if(!quantile.empty())
+                {
+                    text.append(",quantile=\"").append(quantile).append("\"");
+                }
+                text.append("} ").append(std::to_string(value)).append("\n");
+            };
+
+            for(const FunctionSnapshot & function : snapshot())
+            {
+                appendLine("calls_total", function.name, "", function.calls);
+                appendLine("elements_scanned_total", function.name, "", function.elementsScanned);
+                appendLine("bytes_allocated_total", function.name, "", function.bytesAllocated);
+                appendLine("latency_nanoseconds", function.name, "0.5", function.latency.percentile(0.5));
+                appendLine("latency_nanoseconds", function.name, "0.9", function.latency.percentile(0.9));
+                appendLine("latency_nanoseconds", function.name, "0.99", function.latency.percentile(0.99));
+                appendLine("latency_nanoseconds", function.name, "0.999", function.latency.percentile(0.999));
+                appendLine("latency_nanoseconds", function.name, "1", function.latency.maxNanoseconds);
+                appendLine("latency_nanoseconds_sum", function.name, "", function.latency.sumNanoseconds);
+                appendLine("latency_nanoseconds_count", function.name, "", function.latency.count);
+            }
+            return text;
+        }
+    }
+
+
+    /*** Interned strings ***/
+    class StringPool;
+
+    namespace detail
+    {
+        /**
+         * @brief The single stored copy of a string interned by a StringPool, along with its precomputed hash.
+         */
+        struct InternedEntry
+        {
+            std::string str;
+            std::size_t hash;
+            StringPool * pool;
+        };
+
+        inline const InternedEntry & emptyInternedEntry()
+        {
+            static const InternedEntry entry = { "", std::hash<std::string_view>{}(""), nullptr };
+            return entry;
+        }
+    }
+
+
+    /**
+     * @brief A handle to a string stored once in a StringPool. Copying an InternedString copies a pointer, comparing two
+     *        InternedStrings from the same pool for equality compares pointers, and hashing one returns the hash computed
+     *        when the string was interned. Ordering compares the characters, so InternedStrings work as std::map keys too.
+     * 
+     * Example: std::unordered_map<stevensMapLib::InternedString,int> map = { {stevensMapLib::InternedString("style:textColor"), 1} };
+     */
+    class InternedString
+    {
+        public:
+            /**
+             * @brief Constructs the empty string, which belongs to no pool.
+             */
+            InternedString() : m_entry(&detail::emptyInternedEntry()) {}
+
+            /**
+             * @brief Interns str in the global StringPool.
+             */
+            explicit InternedString(    std::string_view str    );
+
+            std::string_view view() const { return m_entry->str; }
+            const std::string & str() const { return m_entry->str; }
+            const char * c_str() const { return m_entry->str.c_str(); }
+            std::size_t size() const { return m_entry->str.size(); }
+            bool empty() const { return m_entry->str.empty(); }
+            std::size_t hash() const { return m_entry->hash; }
+            StringPool * pool() const { return m_entry->pool; }
+            operator std::string_view() const { return m_entry->str; }
+
+            friend bool operator==( const InternedString & a,
+                                    const InternedString & b    )
+            {
+                //Strings from the same pool are equal exactly when they are the same entry
+                return a.m_entry == b.m_entry || (a.m_entry->pool != b.m_entry->pool && a.m_entry->hash == b.m_entry->hash && a.view() == b.view());
+            }
+
+            friend bool operator==( const InternedString & a,
+                                    std::string_view b  )
+            {
+                return a.view() == b;
+            }
+
+            friend std::strong_ordering operator<=>(    const InternedString & a,
+                                                        const InternedString & b    )
+            {
+                return a.m_entry == b.m_entry ? std::strong_ordering::equal : a.view() <=> b.view();
+            }
+
+            friend std::strong_ordering operator<=>(    const InternedString & a,
+                                                        std::string_view b  )
+            {
+                return a.view() <=> b;
+            }
+
+        private:
+            friend class StringPool;
+            explicit InternedString(    const detail::InternedEntry * entry ) : m_entry(entry) {}
+
+            const detail::InternedEntry * m_entry;
+    };
+
+
+    /**
+     * @brief Stores one copy of every distinct string interned in it and hands out InternedStrings that point to those copies.
+     *        Strings live as long as the pool, so a pool can be scoped to a request or arena, or the process-wide pool from
+     *        StringPool::global() can be used. Interning is thread-safe.
+     */
+    class StringPool
+    {
+        public:
+            StringPool() = default;
+            StringPool( const StringPool & ) = delete;
+            StringPool & operator=( const StringPool & ) = delete;
+
+            /**
+             * @brief Returns the InternedString for str, storing a copy of str in the pool if it is not there already.
+             */
+            InternedString intern(  std::string_view str    )
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto it = m_index.find(str);
+                if(it != m_index.end())
+                {
+                    return InternedString(it->second);
+                }
+                const detail::InternedEntry & entry = m_entries.emplace_back( detail::InternedEntry{ std::string(str), std::hash<std::string_view>{}(str), this } );
+                m_index.emplace(entry.str, &entry);
+                return InternedString(&entry);
+            }
+
+            /**
+             * @brief Looks up str without interning it.
+             * 
+             * @return A pointer-sized handle to the pooled copy of str, or std::nullopt if str was never interned in this pool.
+             */
+            std::optional<InternedString> find( std::string_view str    ) const
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto it = m_index.find(str);
+                if(it == m_index.end())
+                {
+                    return std::nullopt;
+                }
+                return InternedString(it->second);
+            }
+
+            std::size_t size() const
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                return m_entries.size();
+            }
+
+            /**
+             * @brief The process-wide pool used by InternedString's string_view constructor.
+             */
+            static StringPool & global()
+            {
+                static StringPool pool;
+                return pool;
+            }
+
+        private:
+            mutable std::mutex m_mutex;
+            std::deque<detail::InternedEntry> m_entries;
+            std::unordered_map<std::string_view, const detail::InternedEntry *> m_index;
+    };
+
+
+    inline InternedString::InternedString(  std::string_view str    ) : InternedString(StringPool::global().intern(str)) {}
+
+
+    namespace detail
+    {
+        /**
+         * @brief Views the characters of a stringlike key, whether it is a std::string, a std::string_view or an InternedString.
+         */
+        template <typename S>
+        std::string_view keyView(   const S & str   )
+        {
+            return std::string_view(str);
+        }
+
+        /**
+         * @brief Makes a key of the same type as prototype holding the characters of str. InternedStrings are interned into the
+         *        same pool as prototype.
+         */
+        template <typename K>
+        K makeKeyLike(  const K & prototype,
+                        std::string_view str    )
+        {
+            if constexpr(std::is_same_v<K, InternedString>)
+            {
+                return prototype.pool() ? prototype.pool()->intern(str) : StringPool::global().intern(str);
+            }
+            else if constexpr(requires { prototype.get_allocator(); })
+            {
+                //Keys like std::pmr::string keep using the memory resource of the key they were made from
+                return K(str, prototype.get_allocator());
+            }
+            else
+            {
+                return K(str);
+            }
+        }
+
+        /**
+         * @brief Returns str with every instance of target erased from it.
+         */
+        inline std::string eraseAll(    std::string_view str,
+                                        std::string_view target )
+        {
+            std::string result;
+            result.reserve(str.size());
+            std::size_t start = 0;
+            for(std::size_t found = str.find(target); found != std::string_view::npos; found = str.find(target, start))
+            {
+                result.append(str.substr(start, found - start));
+                start = found + target.size();
+            }
+            result.append(str.substr(start));
+            return result;
+        }
+
+        /**
+         * @brief Returns key with every instance of target erased from it, or a copy of key if it doesn't contain target.
+         *        Copying an unchanged interned key is just a pointer copy.
+         */
+        template <typename K>
+        K stripKey( const K & key,
+                    std::string_view target )
+        {
+            std::string_view view = keyView(key);
+            if(target.empty() || view.find(target) == std::string_view::npos)
+            {
+                return key;
+            }
+            return makeKeyLike(key, eraseAll(view, target));
+        }
+    }
+}
+
+
+/**
+ * @brief Hashes an InternedString with the hash computed when it was interned.
+ */
+template <>
+struct std::hash<stevensMapLib::InternedString>
+{
+    std::size_t operator()( const stevensMapLib::InternedString & str   ) const noexcept
+    {
+        return str.hash();
+    }
+};
+
+
 namespace stevensMapLib
 {
     /*** Member variables ***/
 
-    /*** Methods ***/
+    namespace detail
+    {
+        /**
+         * @brief Constructs an empty map of the same type as map that uses the given allocator, and map's hasher and key equality
+         *        or comparator, so results keep every property of the map they were built from.
+         */
+        template <typename Map>
+        Map emptyLike(  const Map & map,
+                        const typename Map::allocator_type & allocator  )
+        {
+            if constexpr(requires { map.hash_function(); map.key_eq(); })
+            {
+                return Map(0, map.hash_function(), map.key_eq(), allocator);
+            }
+            else if constexpr(requires { map.key_comp(); })
+            {
+                return Map(map.key_comp(), allocator);
+            }
+            else
+            {
+                return Map(allocator);
+            }
+        }
+
+        /**
+         * @brief Whether a map keeps its keys in increasing order by operator<, which for string keys is character order, so
+         *        that all keys sharing a prefix are adjacent. Pointer keys such as const char * are excluded, since std::less
+         *        orders them by address rather than by their characters.
+         */
+        template <typename Map>
+        constexpr bool isOrderedByLess = requires
+        {
+            typename Map::key_compare;
+            requires !std::is_pointer_v<typename Map::key_type>;
+            requires std::is_same_v<typename Map::key_compare, std::less<typename Map::key_type>> || std::is_same_v<typename Map::key_compare, std::less<>>;
+        };
+
+        /**
+         * @brief Whether a map's comparator supports heterogeneous lookup, e.g. std::less<>.
+         */
+        template <typename Map>
+        constexpr bool hasTransparentCompare = requires { typename Map::key_compare::is_transparent; };
+
+        /**
+         * @brief Makes a stringlike key of type K holding the characters of str, allocated with map's allocator when K accepts one.
+         */
+        template <typename K, typename Map>
+        K makeKeyFor(   const Map & map,
+                        std::string_view str    )
+        {
+            if constexpr(std::is_same_v<K, InternedString>)
+            {
+                return StringPool::global().intern(str);
+            }
+            else if constexpr(std::is_constructible_v<K, std::string_view, decltype(map.get_allocator())>)
+            {
+                return K(str, map.get_allocator());
+            }
+            else
+            {
+                return K(str);
+            }
+        }
+
+        /**
+         * @brief Finds the first key of an ordered map that is not less than the stringlike str, without building a key
+         *        when the map's comparator is transparent.
+         */
+        template <typename Map, typename S>
+        auto prefixLowerBound(  const Map & map,
+                                const S & str   )
+        {
+            if constexpr(std::is_same_v<S, typename Map::key_type>)
+            {
+                return map.lower_bound(str);
+            }
+            else if constexpr(hasTransparentCompare<Map>)
+            {
+                return map.lower_bound(keyView(str));
+            }
+            else
+            {
+                return map.lower_bound(makeKeyFor<typename Map::key_type>(map, keyView(str)));
+            }
+        }
+    }
+
+    /*** Methods ***/
+    /**
+     * @brief The same as addMaps(A, B, addOperationTarget, omitKeysNotShared), but the returned map allocates through resultAllocator.
+     *        Passing a std::pmr::monotonic_buffer_resource for std::pmr maps builds the whole result in that arena.
+     * 
+     * Example: std::pmr::monotonic_buffer_resource arena;
+     *          auto AB = stevensMapLib::addMaps(std::allocator_arg, &arena, A, B, "values");
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    M<K,V,Args...> addMaps  (   std::allocator_arg_t,
+                                const typename M<K,V,Args...>::allocator_type & resultAllocator,
+                                const M<K,V,Args...> & A,
+                                const M<K,V,Args...> & B,
+                                std::string addOperationTarget = "keys and values",
+                                bool omitKeysNotShared = false )
+    {
+        STEVENSMAPLIB_INSTRUMENT("addMaps");
+        M<K,V,Args...> AB = detail::emptyLike(A, resultAllocator);
+
+        //Iterate through the pairs of map A and see if any match the keys of of map B
+        for(const auto & [key,value] : A)
+        {
+            //When we find a match, perform the + operation on the targeted indicated by the addOperationTarget parameter
+            auto match = B.find(key);
+            if(match != B.end())
+            {
+                //Store the matched value in map AB, and keep track of the key in map B that was found as a match
+                if(addOperationTarget == "values")
+                {
+                    AB[key] = value + match->second;
+                }
+                else //keys and values
+                {
+                    AB[key + key] = value + match->second;
+                }
+            }
+            else
+            {
+                if(!omitKeysNotShared)
+                {
+                    //If we do not find a match, check to see if we should omit the key that is not shared. If not, store it in map AB.
+                    AB[key] = value;
+                }
+            }
+        }
+        //If we're not omitting shared keys, add the keys from B that were not matched
+        if(!omitKeysNotShared)
+        {
+            for(const auto & [key,value] : B)
+            {
+                if(!AB.contains(key))
+                {
+                    AB[key] = value;
+                }
+            }
+        }
+
+        STEVENSMAPLIB_RECORD_SCANNED(A.size() + (omitKeysNotShared ? 0 : B.size()));
+        STEVENSMAPLIB_RECORD_ALLOCATED(AB);
+        return AB;
+    }
+
+
+    /**
+     * Takes two maplike structures as input and performs the + operation on their shared keys. The resulting pairs
+     * are returned in a maplike object of the same type.
+     * 
+     * Parameters:
+     *  M<K,V> A - One of the maplike objects we are adding together.
+     *  M<K,V> B - The other maplike object we are adding to the first.
+     *  std::string addOperationTarget - The target of the + operator with this function. Possible values are:
+     *                                   ///"keys" - Only perform the + operation on keys
+     *                                   "values" - Only perform the + operation on the values
+     *                                   "keys and values" - Perform the + operation on both keys and values 
+     *  bool omitKeysNotShared - Boolean indicating whether or not we should omit the pairs from A and B that they do not share from the returned map.
+     * 
+     * Returns:
+     *  M<K,V,Args...> - The sum of A and B, a map of the same type as A and B (including its comparator or hasher and allocator)
+     *                   which allocates through A's allocator.
+    */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    M<K,V,Args...> addMaps  (   const M<K,V,Args...> & A,
+                                const M<K,V,Args...> & B,
+                                std::string addOperationTarget = "keys and values",
+                                bool omitKeysNotShared = false )
+    {
+        return stevensMapLib::addMaps(std::allocator_arg, A.get_allocator(), A, B, addOperationTarget, omitKeysNotShared);
+    }
+
+
+    /**
+     * @brief The same as multiplyWithValues(map, factor), but multiplies the values of a map we no longer need in place
+     *        instead of copying it.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    M<K,V,Args...> multiplyWithValues(  M<K,V,Args...> && map,
+                                        long double factor)
+    {
+        STEVENSMAPLIB_INSTRUMENT("multiplyWithValues");
+        STEVENSMAPLIB_RECORD_SCANNED(map.size());
+        //Iterate through the map, multipling each value by the factor and setting the value equal to the product
+        for(auto & [key,value] : map)
+        {
+            value = value * factor;
+        }
+
+        return map;
+    }
+
+
+    /**
+     * @brief The same as multiplyWithValues(map, factor), but the returned map allocates through resultAllocator.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    M<K,V,Args...> multiplyWithValues(  std::allocator_arg_t,
+                                        const typename M<K,V,Args...>::allocator_type & resultAllocator,
+                                        const M<K,V,Args...> & map,
+                                        long double factor)
+    {
+        return stevensMapLib::multiplyWithValues(M<K,V,Args...>(map, resultAllocator), factor);
+    }
+
+
+    /**
+     * @brief Given a map with values of a numeric type and a numeric factor, multiply each value in the map by the factor, setting the 
+     *        values for each pair to be equal to the product of the factor and the initial value.
+     * 
+     * @param map The maplike object we are multiplying the values of.
+     * @param factor The factor we are multiplying the values of the map by.
+     * 
+     * @return A copy of the map parameter, using the same allocator, but with all of its values multiplied by the factor parameter.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    M<K,V,Args...> multiplyWithValues(  const M<K,V,Args...> & map,
+                                        long double factor)
+    {
+        return stevensMapLib::multiplyWithValues(std::allocator_arg, map.get_allocator(), map, factor);
+    }
+
+
+    /**
+     * @brief Given a map with values of a numeric type and a numeric initial value, sum all of the values in the map with eachtother.
+     * 
+     * @param map The map containing numeric values that we want to sum together.
+     * @param initialValue The value we begin our sum from.
+     * 
+     * @return The sum of all values in the map added to the initial value
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    V sumAllValues( const M<K,V,Args...> & map,
+                    V initialValue = 0  )
+    {
+        STEVENSMAPLIB_INSTRUMENT("sumAllValues");
+        STEVENSMAPLIB_RECORD_SCANNED(map.size());
+        V sum = initialValue;
+
+        for(const auto & [key, value] : map)
+        {
+            sum += value; 
+        }
+
+        return sum;
+    }
+
+
+
+    /**
+     * Converts a maplike object with keys of type K and values of type V to a vector of tuples with the first index containing the key
+     * and the second index containing the value.
+     * 
+     * Parameter:
+     *  M<K,V> umap - The map that we want to convert to a vector of tuples.
+     * 
+     * Returns:
+     *  std::vector< tuple<K,V> > - A vector containing tuples of the key-value pairs from the passed-in map in no particular order.
+     * 
+    */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    std::vector< std::tuple<K,V> > mapToVecOfTuples( const M<K,V,Args...> & map )
+    {
+        STEVENSMAPLIB_INSTRUMENT("mapToVecOfTuples");
+        std::vector< std::tuple<K,V> > returnVec = {};
+        returnVec.reserve(map.size());
+
+        //Iterate through the unordered_map
+        for(const auto & [key,value] : map)
+        {
+            //Construct a tuple containing the key and the value and push it to the returnVec
+            returnVec.push_back( std::make_tuple(key,value) );
+        }
+
+        STEVENSMAPLIB_RECORD_SCANNED(map.size());
+        STEVENSMAPLIB_RECORD_ALLOCATED(returnVec);
+        return returnVec;
+    }
+
+
+    /**
+     * @brief The same as erase(map, keysToErase), but erases the keys from a map we no longer need in place instead of copying it.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    M<K,V,Args...> erase(   M<K,V,Args...> && map, 
+                            const std::vector<K> & keysToErase)
+    {
+        STEVENSMAPLIB_INSTRUMENT("erase");
+        STEVENSMAPLIB_RECORD_SCANNED(keysToErase.size());
+        //For each key to erase, erase it from the map
+        for(std::size_t i = 0; i < keysToErase.size(); i++)
+        {
+            map.erase(keysToErase[i]);
+        }
+        return map;
+    }
+
+
+    /**
+     * @brief The same as erase(map, keysToErase), but the returned map allocates through resultAllocator.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    M<K,V,Args...> erase(   std::allocator_arg_t,
+                            const typename M<K,V,Args...>::allocator_type & resultAllocator,
+                            const M<K,V,Args...> & map, 
+                            const std::vector<K> & keysToErase)
+    {
+        return stevensMapLib::erase(M<K,V,Args...>(map, resultAllocator), keysToErase);
+    }
+
+
+    /**
+     * @brief Given a map with typing M<K,V>, return the map with all of its keys contained in a given vector erased.
+     * 
+     * @param map The map we want to erase keys from.
+     * @param keysToErase A vector of keys we want to erase from the map, if the map contains them.
+     * 
+     * @return A copy of the parameter map, using the same allocator, but with all of its keys contained within keysToErase erased from it.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    M<K,V,Args...> erase(   const M<K,V,Args...> & map, 
+                            const std::vector<K> & keysToErase)
+    {
+        return stevensMapLib::erase(std::allocator_arg, map.get_allocator(), map, keysToErase);
+    }
+
+
+    /**
+     * @brief Gets a random key from a maplike object
+     * 
+     * @tparam M The maplike type that we are getting a key from.
+     * @tparam K The key type we are getting.
+     * @tparam V The value of the pairs in the maplike type we are getting a key from.
+     * 
+     * @param map - The map object we are picking a random key from.
+     * 
+     * @return A random key found in map.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    K getRandomKey( const M<K,V,Args...> & map )
+    {
+        STEVENSMAPLIB_INSTRUMENT("getRandomKey");
+        if(map.size() == 0)
+        {
+            throw std::invalid_argument("stevensMapLib::getRandomKey() cannot get a random key from an empty map");
+        }
+        auto it = map.begin();
+        long long int advanceAmount = rand() % map.size();
+        std::ranges::advance( it, advanceAmount );
+        STEVENSMAPLIB_RECORD_SCANNED(advanceAmount + 1);
+        return it->first;
+    }
+
+
+    /**
+     * @brief Gets a random value from a maplike object
+     * 
+     * @tparam M the maplike type we are getting a value from.
+     * @tparam K the type of key in the maplike type we are getting a value from.
+     * @tparam V the type of value we are getting.
+     * 
+     * @param map The map object we are picking a random value from.
+     * 
+     * @return A random value found in map.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    V getRandomValue( const M<K,V,Args...> & map )
+    {
+        STEVENSMAPLIB_INSTRUMENT("getRandomValue");
+        if(map.size() == 0)
+        {
+            throw std::invalid_argument("stevensMapLib::getRandomValue() cannot get a random value from an empty map");
+        }
+        return map.at(stevensMapLib::getRandomKey(map));
+    }
+
+
+    /**
+     * @brief Returns the first key in the maplike object.
+     * 
+     * @tparam M The maplike type that we are getting a key from.
+     * @tparam K The key type we are getting.
+     * @tparam V The value of the pairs in the maplike type we are getting a key from.
+     * 
+     * @param map - The map object we are getting the first key from.
+     * 
+     * @return The first key from the map.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    K getFirstKey( const M<K,V,Args...> & map)
+    {
+        STEVENSMAPLIB_INSTRUMENT("getFirstKey");
+        auto it = map.begin();
+        return it->first;
+    }
+
+
+    /**
+     * @brief Gets a vector containing all of the keys from each pair within the given map.
+     * 
+     * @tparam M The type of the maplike object we are obtaining keys from.
+     * @tparam K The type of the keys in the map.
+     * @tparam V The type of the values in the map.
+     * @tparam Args 
+     * @param map - The maplike object we are obtaining keys from.
+     * @return std::vector<K> - A vector containing all of the keys found in order from the maplike object.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    std::vector<K> getKeyVector(    const M<K,V,Args...> & map  )
+    {
+        STEVENSMAPLIB_INSTRUMENT("getKeyVector");
+        //Initialize a vector that we will push keys back into
+        std::vector<K> keyVector;
+        keyVector.reserve(map.size());
+        for(const auto & [key,value] : map)
+        {
+            keyVector.push_back(key);
+        }
+        STEVENSMAPLIB_RECORD_SCANNED(map.size());
+        STEVENSMAPLIB_RECORD_ALLOCATED(keyVector);
+        return keyVector;
+    }
+
+
+    /**
+     * @brief Gets a vector containing all of the values from each pair within the given map.
+     * 
+     * @tparam M The type of maplike object we are obtaining values from.
+     * @tparam K The type of keys in the map.
+     * @tparam V THe type of values in the map.
+     * @tparam Args
+     * @param map - THe maplike object we are obtaining values from.
+     * @return std::vector<V> - A vector containing all of the values found in order from the maplike object.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    std::vector<V> getValueVector(  const M<K,V,Args...> & map )
+    {
+        STEVENSMAPLIB_INSTRUMENT("getValueVector");
+        //Initialize a vector that we will push values back into
+        std::vector<V> valueVector;
+        valueVector.reserve(map.size());
+        for(const auto & [key,value] : map)
+        {
+            valueVector.push_back(value);
+        }
+        STEVENSMAPLIB_RECORD_SCANNED(map.size());
+        STEVENSMAPLIB_RECORD_ALLOCATED(valueVector);
+        return valueVector;
+    }
+
+
+    /**
+     * @brief The same as getPairsWhereKeysStartWith(map, str), but the returned map allocates through resultAllocator.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args, typename S>
+    M<K,V,Args...> getPairsWhereKeysStartWith(  std::allocator_arg_t,
+                                                const typename M<K,V,Args...>::allocator_type & resultAllocator,
+                                                const M<K,V,Args...> & map,
+                                                const S & str   )
+    {
+        STEVENSMAPLIB_INSTRUMENT("getPairsWhereKeysStartWith");
+        //This is the map that we'll return
+        M<K,V,Args...> returnMap = detail::emptyLike(map, resultAllocator);
+        std::string_view prefix = detail::keyView(str);
+
+        //Maps ordered by character keep all of the keys starting with str next to each other, so we can binary search for the
+        //first one and stop at the first key that doesn't match. Interned keys are only searched this way when str is already
+        //interned, so that searching doesn't add the prefix to a pool.
+        if constexpr(detail::isOrderedByLess<M<K,V,Args...>> && (std::is_same_v<S,K> || !std::is_same_v<K,InternedString> || detail::hasTransparentCompare<M<K,V,Args...>>))
+        {
+            for(auto it = detail::prefixLowerBound(map, str); it != map.end() && detail::keyView(it->first).starts_with(prefix); it++)
+            {
+                returnMap.emplace_hint(returnMap.end(), it->first, it->second);
+            }
+            STEVENSMAPLIB_RECORD_SCANNED(returnMap.size());
+            STEVENSMAPLIB_RECORD_ALLOCATED(returnMap);
+            return returnMap;
+        }
+
+        //Iterate through all the keys in the map
+        for(const auto & [key,value] : map)
+        {
+            //Add the pair that starts with str to the map that will be returned
+            if(detail::keyView(key).starts_with(prefix))
+            {
+                returnMap.emplace(key, value);
+            }
+        }
+        STEVENSMAPLIB_RECORD_SCANNED(map.size());
+        STEVENSMAPLIB_RECORD_ALLOCATED(returnMap);
+        //Return the map with pairs that have only keys beginning with str
+        return returnMap;
+    }
+
+
+    /**
+     * @brief Returns a maplike object which uses stringlike keys that begin only with a certain combination of characters.
+     * 
+     * Example: resultMap = stevensMapLib::getPairsWhereKeysStartWith("style:", { {"style:textColor","red"}, {"style:backgroundColor", "black"}, {"sectionName", "header"} });
+     * //resultMap == { {"style:textColor", "red"}, {"style:backgroundColor", "black"}  };
+     * 
+     * @tparam M The type of the maplike object we are getting pairs from.
+     * @tparam K The type of keys in the map. Must be stringlike, e.g. std::string or InternedString. 
+     * @tparam V The type of values in the map.
+     * @tparam Args
+     * @tparam S The type of str. Any stringlike type works, such as std::string_view or a string literal, so callers don't need
+     *           to build a key-typed string just to search.
+     * @param str - Stringlike string of characters we want all of our keys in our resulting map to start with, which are also contained within map
+     * @param map - The maplike object we are extracting key-value pairs from, which the keys must begin with str. When map is
+     *              ordered by std::less<K> or std::less<>, only the pairs that start with str are visited.
+     * 
+     * @return M<K,V,Args...> A maplike object of the same type as map, using map's allocator, which contains only keys that start with the requested string of characters.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args, typename S>
+    M<K,V,Args...> getPairsWhereKeysStartWith(  const M<K,V,Args...> & map,
+                                                const S & str   )
+    {
+        return stevensMapLib::getPairsWhereKeysStartWith(std::allocator_arg, map.get_allocator(), map, str);
+    }
+
+
+    /**
+     * @brief The same as eraseStringFromKeys(map, str), but the returned map allocates through resultAllocator.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args, typename S>
+    M<K,V,Args...> eraseStringFromKeys( std::allocator_arg_t,
+                                        const typename M<K,V,Args...>::allocator_type & resultAllocator,
+                                        const M<K,V,Args...> & map,
+                                        const S & str   )
+    {
+        STEVENSMAPLIB_INSTRUMENT("eraseStringFromKeys");
+        //The map that will be returned
+        M<K,V,Args...> returnMap = detail::emptyLike(map, resultAllocator);
+        std::string_view target = detail::keyView(str);
+
+        //Iterate through all the keys in the map, removing str from each key's name and adding it to our return map
+        for(const auto & [key,value] : map)
+        {
+            returnMap.emplace(detail::stripKey(key, target), value);
+        }
+
+        STEVENSMAPLIB_RECORD_SCANNED(map.size());
+        STEVENSMAPLIB_RECORD_ALLOCATED(returnMap);
+        return returnMap;
+    }
+
+
+    /**
+     * @brief Modifies a maplike object's stringlike keys by erasing all instances of a substring from the keys.
+     * 
+     * Example: resultMap = stevensMapLib::eraseStringFromKeys( "style:",   {   {"style:textColor", "red"}, {"style:backgroundColor", "black"}  });
+     * //resultMap == { {"textColor", "red"},   {"backgroundColor", "black"}};
+     * 
+     * @tparam M The type of maplike object we are modifying the keys of.
+     * @tparam K The type of keys in the map. Must be stringlike, e.g. std::string or InternedString. Modified InternedString
+     *           keys are interned into the same pool as the original key.
+     * @tparam S The type of str. Any stringlike type works, such as std::string_view or a string literal.
+     * @param str The string we wish to target and erase from all of map's keys.
+     * @param map The maplike object with stringlike keys we are modifying the keys of.
+     * @return M<K,V,Args...> A modified version of the map we passed into the function, using the same allocator, with all of its keys having str erased from them.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args, typename S>
+    M<K,V,Args...> eraseStringFromKeys( const M<K,V,Args...> & map,
+                                        const S & str   )
+    {
+        return stevensMapLib::eraseStringFromKeys(std::allocator_arg, map.get_allocator(), map, str);
+    }
+
+
+    /**
+     * @brief Given a maplike object with values of a numeric tyoe, return the map with all of its elements that have 
+     *        values less than zero set to zero.
+     * 
+     * Example:
+     * setNegativeValuesTOZero( {{"firstKey", 3}, {"secondKey", -9001}, {"thirdKey", -4}} ) == { {"firstKey",3}, {"secondKey",0}, {"thirdKey",0} };
+     * 
+     * @param map - The maplike object with numeric values (bool, short, int, long, float, double, etc) that we want its negative values set to zero.
+     * @return Void, but directly modifies the map object we pass in by reference.
+     */
+    template<typename M>
+    requires requires { typename M::mapped_type; }
+    void setNegativeValuesToZero( M & map )
+    {
+        STEVENSMAPLIB_INSTRUMENT("setNegativeValuesToZero");
+        STEVENSMAPLIB_RECORD_SCANNED(map.size());
+        using V = typename M::mapped_type;
+        for(auto & [key,value] : map)
+        {
+            //Writing through the reference with max() needs no branch and no second lookup of the key
+            value = std::max(value, V(0));
+        }
+    }
+
+
+    /**
+     * @brief Given a maplike object that uses stringlike keys and a prospective key for the map, modify the key so that it
+     *        it is unique from anything else in map. Useful for creating new, valid keys for maps.
+     * 
+     * @tparam M The type of maplike object object we are creating a unique key for.
+     * @tparam K The stringlike type of key we are creating a unique instance of for the map. InternedString keys are only
+     *           interned once the unique key has been found.
+     * @tparam V The type of value in the maplike object map.
+     * @tparam Args
+     * @param map The maplike object we are creating a unique key for.
+     * @param keyString The stringlike key we are potentially modifying to be unique relative to all other keys in map.
+     * @param algorithm The method by which we modify our key to make it unique.
+     * 
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    K createUniqueKeyString(    const M<K,V,Args...> & map,
+                                K keyString = "",
+                                const std::string & algorithm = "integer concatenation"    )
+    {
+        STEVENSMAPLIB_INSTRUMENT("createUniqueKeyString");
+        if(algorithm == "integer concatenation")
+        {
+            if constexpr(std::is_same_v<K, InternedString>)
+            {
+                //Keys from other pools compare equal by their characters, so each candidate is looked up by its text: directly
+                //when the map allows heterogeneous lookup, otherwise through a scratch pool no key of the map can belong to.
+                //Only the final key is interned in keyString's pool
+                StringPool & pool = keyString.pool() ? *keyString.pool() : StringPool::global();
+                StringPool scratch;
+                auto containsText = [&](std::string_view text)
+                {
+                    if constexpr(requires { map.contains(text); })
+                    {
+                        return map.contains(text);
+                    }
+                    else
+                    {
+                        return map.contains(scratch.intern(text));
+                    }
+                };
+                std::string candidate(keyString.view());
+                int integerSuffix = 0;
+                while(containsText(candidate))
+                {
+                    candidate = keyString.str() + std::to_string(integerSuffix);
+                    integerSuffix++;
+                }
+                keyString = pool.intern(candidate);
+            }
+            else
+            {
+                K originalKeyString = keyString;
+                int integerSuffix = 0;
+                while(map.contains(keyString))
+                {
+                    keyString = originalKeyString + std::to_string(integerSuffix);
+                    integerSuffix++;
+                }
+            }
+        }
+
+        return keyString;
+    }
+
+
+    /**
+     * @brief Given a maplike object, return a random key-value pair from the map, deleting it from the map in the process.
+     * 
+     * @tparam M The type of the maplike object we are popping a pair from.
+     * @tparam K The type of key in the pair we are popping from the map.
+     * @tparam V The type of value in the pair we are popping from the map.
+     * @tparam Args
+     * @param map The maplike object we are popping a key-value pair from.
+     * @return A random pair from the map
+     * 
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    std::pair<K,V> popRandom(   M<K,V,Args...> & map    )
+    {
+        STEVENSMAPLIB_INSTRUMENT("popRandom");
+        //Can't pop a key if the map is empty
+        if(map.size() == 0)
+        {
+            throw std::invalid_argument("stevensMapLib::popRandom() cannot pop a random pair from an empty map");
+        }
+
+        //Get a random pair from the map using getRandomKey()
+        K key = stevensMapLib::getRandomKey(map);
+        V value = map[key];
+        //Construct the pair we want to return
+        std::pair<K,V> randomPair = std::pair(key, value);
+        //Erase the pair from the source map
+        map.erase(key);
+        return randomPair;
+    }
+
+
+    /**
+     * @brief Given a maplike object map, insert a range of integers as string keys within the map.
+     * 
+     * @tparam M The type of the maplike object map.
+     * @tparam K The keys belonging to the maplike object map.
+     * @tparam V The values belonging to the maplike object map.
+     * @tparam Args
+     * @param map The maplike object we are inserting an integer range of keys into.
+     * @param rangeStart The first number to insert as a key into the map.
+     * @param rangeEnd The last number to insert as a key into the map.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    void insertNumericRangeAsStringKeys(    M<K,V,Args...> & map,
+                                            const long long int & rangeStart,
+                                            const long long int & rangeEnd  )
+    {
+        STEVENSMAPLIB_INSTRUMENT("insertNumericRangeAsStringKeys");
+        if(rangeStart > rangeEnd)
+        {
+            return;
+        }
+        //Counted in unsigned arithmetic, since the width of the range can overflow a long long
+        STEVENSMAPLIB_RECORD_SCANNED(static_cast<unsigned long long>(rangeEnd) - static_cast<unsigned long long>(rangeStart) + 1);
+        //Insert every number in the range as a string key, built with the map's allocator so std::pmr keys stay in its memory resource
+        char digits[24];
+        for(long long int i = rangeStart; ; i++)
+        {
+            char * digitsEnd = std::to_chars(digits, digits + sizeof(digits), i).ptr;
+            map.try_emplace(detail::makeKeyFor<K>(map, std::string_view(digits, digitsEnd - digits)));
+            //Stop before incrementing, so a range ending at LLONG_MAX doesn't overflow i
+            if(i == rangeEnd)
+            {
+                break;
+            }
+        }
+    }
+
+
+    /**
+     * @brief Given a maplike object with a numeric-type as its values, return the key-value pair from the
+     *        maplike object with the greatest value. If more than one pair has the greatest value, we will return
+     *        the pair that comes earliest in iterating through the pairs.
+     * 
+     * @param map The maplike object with numeric values which we are obtaining pair with the greatest value.
+     * @return A std::pair<K,V> object from map containing the greatest value from all existing pairs in the map.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    std::pair<K,V> getPairWithMaxValue( const M<K,V,Args...> & map  )
+    {
+        STEVENSMAPLIB_INSTRUMENT("getPairWithMaxValue");
+        //Check to see if the map is empty; we can't get a pair from an empty map
+        if(map.empty())
+        {
+            throw std::invalid_argument("stevensMapLib::getPairWithMaxValue() cannot get a pair from an empty map");
+        }
+
+        STEVENSMAPLIB_RECORD_SCANNED(map.size());
+        //Establish the key and value of the max pair
+        K maxKey = stevensMapLib::getFirstKey(map);
+        V maxValue = map.at(maxKey);
+        //Iterate through all of the the key-value pairs in the map
+        for(const auto & [key,value] : map)
+        {
+            //If we find a value greater than the max value, set the max value to the value of the current pair's value
+            if(value > maxValue)
+            {
+                maxValue = value;
+                maxKey = key;
+            }
+        }
+
+        //Reconstruct the pair we found containing the max value from the map
+        std::pair<K,V> maxPair = std::pair(maxKey, maxValue); 
+        return maxPair;
+    }
+
+
+    /**
+     * @brief Given a maplike object with a numeric type object for its keys (or a type that can be compared with > < operators),
+     *        return the key-value pair from the maplike object with the greatest key.
+     * 
+     * @param map The maplike object with a comparable type for keys which we are obtaining the pair with the greatest key.
+     * @return A std::pair<K,V> object from map containing the greatest key from all pairs existing in the map.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    std::pair<K,V> getPairWithMaxKey(   const M<K,V,Args...> & map  )
+    {
+        STEVENSMAPLIB_INSTRUMENT("getPairWithMaxKey");
+        //Check to see if the map is empty; we can't get a pair from an empty map
+        if(map.empty())
+        {
+            throw std::invalid_argument("stevensMapLib::getPairWithMaxKey() cannot get a pair from an empty map");
+        }
+
+        STEVENSMAPLIB_RECORD_SCANNED(map.size());
+        //Establish the key and value of the max pair
+        K maxKey = stevensMapLib::getFirstKey(map);
+        V maxValue = map.at(maxKey);
+        //Iterate through all of the the key-value pairs in the map
+        for(const auto & [key,value] : map)
+        {
+            //If we find a key greater than the max key, set the max key to the the current pair's key
+            if(key > maxKey)
+            {
+                maxValue = value;
+                maxKey = key;
+            }
+        }
+
+        //Reconstruct the pair we found containing the max key from the map
+        std::pair<K,V> maxPair = std::pair(maxKey, maxValue); 
+        return maxPair;
+    }
+
+    /*** Frozen maps ***/
+    /**
+     * @brief The hash function used by FrozenMap. Hashes stringlike keys (anything convertible to std::string_view) with a
+     *        seeded FNV-1a and integral or enum keys with a seeded splitmix64 finalizer, both of which can be evaluated at
+     *        compile time.
+     */
+    struct FrozenHash
+    {
+        template <typename K>
+        constexpr std::uint64_t operator()(    const K & key,
+                                                std::uint64_t seed  ) const
+        {
+            if constexpr(std::is_convertible_v<const K &, std::string_view>)
+            {
+                std::string_view str = key;
+                std::uint64_t hash = 14695981039346656037ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+                for(char c : str)
+                {
+                    hash ^= static_cast<unsigned char>(c);
+                    hash *= 1099511628211ULL;
+                }
+                return mix(hash);
+            }
+            else
+            {
+                static_assert(std::is_integral_v<K> || std::is_enum_v<K>, "stevensMapLib::FrozenHash can only hash stringlike, integral or enum keys");
+                return mix(static_cast<std::uint64_t>(key) + seed * 0x9E3779B97F4A7C15ULL);
+            }
+        }
+
+        private:
+            static constexpr std::uint64_t mix( std::uint64_t x )
+            {
+                x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+                return x ^ (x >> 31);
+            }
+    };
+
+
+    /**
+     * @brief An immutable maplike object whose keys are placed with a minimal perfect hash computed when the map is constructed.
+     *        Because construction is constexpr, a FrozenMap declared constexpr is built entirely by the compiler, so startup does
+     *        no hashing, allocation or construction work. A lookup is one hash to find the key's bucket, one hash to find its slot
+     *        and a single key comparison.
+     * 
+     * The perfect hash uses hash-and-displace: keys are grouped into N buckets, and each bucket (largest first) is assigned the
+     * first seed that sends all of its keys to free slots. Buckets holding a single key are placed directly into a remaining slot.
+     * 
+     * Example: constexpr auto styles = stevensMapLib::makeFrozenMap<std::string_view,int>({ {"style:textColor", 1}, {"style:backgroundColor", 2}, {"sectionName", 3} });
+     * //styles.at("style:textColor") == 1
+     * 
+     * @tparam K The type of keys in the map. Must be stringlike (e.g. std::string_view) or integral to be hashed by FrozenHash.
+     * @tparam V The type of values in the map.
+     * @tparam N The number of pairs in the map.
+     * @tparam Hash A seeded hash function callable as hash(key, seed).
+     */
+    template <typename K, typename V, std::size_t N, typename Hash = FrozenHash>
+    class FrozenMap
+    {
+        public:
+            using key_type = K;
+            using mapped_type = V;
+            using value_type = std::pair<K,V>;
+            using size_type = std::size_t;
+            using const_iterator = typename std::array<value_type,N>::const_iterator;
+            using iterator = const_iterator;
+
+            /**
+             * @brief Builds the perfect hash for the given pairs. Throws std::invalid_argument (a compile error when evaluated
+             *        constexpr) if the same key appears twice.
+             * 
+             * @param pairs The key-value pairs the map will hold.
+             */
+            constexpr FrozenMap(    const std::array<value_type,N> & pairs  )
+            {
+                if constexpr(N > 0)
+                {
+                    Hash hash{};
+
+                    //Group the pairs by bucket with a counting sort so each bucket's members are contiguous in memberOrder
+                    std::array<std::size_t,N+1> bucketStart{};
+                    std::array<std::size_t,N> memberOrder{};
+                    for(std::size_t i = 0; i < N; i++)
+                    {
+                        bucketStart[hash(pairs[i].first, 0) % N + 1]++;
+                    }
+                    for(std::size_t b = 0; b < N; b++)
+                    {
+                        bucketStart[b+1] += bucketStart[b];
+                    }
+                    std::array<std::size_t,N> fill{};
+                    for(std::size_t i = 0; i < N; i++)
+                    {
+                        std::size_t b = hash(pairs[i].first, 0) % N;
+                        memberOrder[bucketStart[b] + fill[b]++] = i;
+                    }
+
+                    //Place the largest buckets first, since they are the hardest to fit
+                    std::array<std::size_t,N> bucketOrder{};
+                    for(std::size_t b = 0; b < N; b++)
+                    {
+                        std::size_t j = b;
+                        while(j > 0 && bucketSize(bucketStart, bucketOrder[j-1]) < bucketSize(bucketStart, b))
+                        {
+                            bucketOrder[j] = bucketOrder[j-1];
+                            j--;
+                        }
+                        bucketOrder[j] = b;
+                    }
+
+                    std::array<bool,N> slotTaken{};
+                    std::size_t nextFreeSlot = 0;
+                    for(std::size_t b : bucketOrder)
+                    {
+                        std::size_t first = bucketStart[b];
+                        std::size_t size = bucketSize(bucketStart, b);
+                        if(size == 0)
+                        {
+                            break;
+                        }
+                        if(size == 1)
+                        {
+                            //A lone key goes straight into the next free slot, recorded as a negative seed
+                            while(slotTaken[nextFreeSlot])
+                            {
+                                nextFreeSlot++;
+                            }
+                            slotTaken[nextFreeSlot] = true;
+                            m_seeds[b] = -static_cast<std::int64_t>(nextFreeSlot) - 1;
+                            m_pairs[nextFreeSlot] = pairs[memberOrder[first]];
+                            continue;
+                        }
+
+                        //Two keys in the same bucket that are equal can never be separated
+                        for(std::size_t i = first; i < first + size; i++)
+                        {
+                            for(std::size_t j = i + 1; j < first + size; j++)
+                            {
+                                if(pairs[memberOrder[i]].first == pairs[memberOrder[j]].first)
+                                {
+                                    throw std::invalid_argument("stevensMapLib::FrozenMap cannot be built from pairs with duplicate keys");
+                                }
+                            }
+                        }
+
+                        //Try seeds until every key of the bucket lands on a distinct free slot
+                        std::array<std::size_t,N> candidate{};
+                        for(std::uint64_t seed = 1; ; seed++)
+                        {
+                            bool fits = true;
+                            for(std::size_t i = 0; i < size && fits; i++)
+                            {
+                                candidate[i] = hash(pairs[memberOrder[first + i]].first, seed) % N;
+                                fits = !slotTaken[candidate[i]];
+                                for(std::size_t j = 0; j < i && fits; j++)
+                                {
+                                    fits = candidate[j] != candidate[i];
+                                }
+                            }
+                            if(fits)
+                            {
+                                for(std::size_t i = 0; i < size; i++)
+                                {
+                                    slotTaken[candidate[i]] = true;
+                                    m_pairs[candidate[i]] = pairs[memberOrder[first + i]];
+                                }
+                                m_seeds[b] = static_cast<std::int64_t>(seed);
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+
+            constexpr const_iterator begin() const { return m_pairs.begin(); }
+            constexpr const_iterator end() const { return m_pairs.end(); }
+            constexpr size_type size() const { return N; }
+            constexpr bool empty() const { return N == 0; }
+
+            /**
+             * @brief Finds the pair with the given key.
+             * 
+             * @param key The key we are looking for. May be any type comparable with K that Hash accepts, such as a
+             *            const char * or std::string for std::string_view keys.
+             * @return An iterator to the pair with the key, or end() if the map does not contain it.
+             */
+            template <typename Q>
+            constexpr const_iterator find(  const Q & key   ) const
+            {
+                if constexpr(N == 0)
+                {
+                    return end();
+                }
+                else
+                {
+                    Hash hash{};
+                    std::int64_t seed = m_seeds[hash(key, 0) % N];
+                    std::size_t slot = seed < 0 ? static_cast<std::size_t>(-seed - 1) : hash(key, static_cast<std::uint64_t>(seed)) % N;
+                    return m_pairs[slot].first == key ? m_pairs.begin() + slot : end();
+                }
+            }
+
+            template <typename Q>
+            constexpr bool contains(    const Q & key   ) const
+            {
+                return find(key) != end();
+            }
+
+            template <typename Q>
+            constexpr const V & at( const Q & key   ) const
+            {
+                const_iterator it = find(key);
+                if(it == end())
+                {
+                    throw std::out_of_range("stevensMapLib::FrozenMap::at() could not find the requested key");
+                }
+                return it->second;
+            }
+
+        private:
+            static constexpr std::size_t bucketSize(    const std::array<std::size_t,N+1> & bucketStart,
+                                                        std::size_t bucket  )
+            {
+                return bucketStart[bucket+1] - bucketStart[bucket];
+            }
+
+            std::array<value_type,N> m_pairs{};
+            std::array<std::int64_t,N> m_seeds{};
+    };
+
+
+    /**
+     * @brief Builds a FrozenMap from a braced list of pairs, deducing the number of pairs.
+     * 
+     * Example: constexpr auto map = stevensMapLib::makeFrozenMap<std::string_view,int>({ {"a", 1}, {"b", 2} });
+     * 
+     * @tparam K The type of keys in the map.
+     * @tparam V The type of values in the map.
+     * @param pairs The key-value pairs the map will hold.
+     * @return A FrozenMap containing pairs.
+     */
+    template <typename K, typename V, typename Hash = FrozenHash, std::size_t N>
+    constexpr FrozenMap<K,V,N,Hash> makeFrozenMap(  const std::pair<K,V> (&pairs)[N]    )
+    {
+        std::array<std::pair<K,V>,N> pairArray{};
+        for(std::size_t i = 0; i < N; i++)
+        {
+            pairArray[i] = pairs[i];
+        }
+        return FrozenMap<K,V,N,Hash>(pairArray);
+    }
+
+
+    /**
+     * @brief Gets a vector containing all of the keys of a FrozenMap, in slot order.
+     * 
+     * @param map - The FrozenMap we are obtaining keys from.
+     * @return std::vector<K> - A vector containing all of the keys in the map.
+     */
+    template <typename K, typename V, std::size_t N, typename Hash>
+    std::vector<K> getKeyVector(    const FrozenMap<K,V,N,Hash> & map   )
+    {
+        std::vector<K> keyVector;
+        keyVector.reserve(N);
+        for(const auto & [key,value] : map)
+        {
+            keyVector.push_back(key);
+        }
+        return keyVector;
+    }
+
+
+    /**
+     * @brief Returns the pairs of a FrozenMap whose stringlike keys begin with a certain combination of characters. Since a
+     *        FrozenMap cannot be built at runtime, the pairs are returned in a std::unordered_map.
+     * 
+     * @param map - The FrozenMap we are extracting key-value pairs from.
+     * @param str - Stringlike string of characters we want all of the keys in our resulting map to start with.
+     * @return std::unordered_map<K,V> containing only the pairs whose keys start with str.
+     */
+    template <typename K, typename V, std::size_t N, typename Hash>
+    std::unordered_map<K,V> getPairsWhereKeysStartWith( const FrozenMap<K,V,N,Hash> & map,
+                                                        std::string_view str    )
+    {
+        std::unordered_map<K,V> returnMap = {};
+        for(const auto & [key,value] : map)
+        {
+            if(std::string_view(key).starts_with(str))
+            {
+                returnMap.emplace(key, value);
+            }
+        }
+        return returnMap;
+    }
+
+
+    /**
+     * @brief Returns the pair of a FrozenMap with the greatest value. If more than one pair has the greatest value, the pair
+     *        that comes earliest in the map's slot order is returned. Can be evaluated at compile time.
+     * 
+     * @param map The FrozenMap with numeric values we are obtaining the pair with the greatest value from.
+     * @return A std::pair<K,V> from map containing the greatest value of all pairs in the map.
+     */
+    template <typename K, typename V, std::size_t N, typename Hash>
+    constexpr std::pair<K,V> getPairWithMaxValue(   const FrozenMap<K,V,N,Hash> & map   )
+    {
+        if(map.empty())
+        {
+            throw std::invalid_argument("stevensMapLib::getPairWithMaxValue() cannot get a pair from an empty map");
+        }
+
+        auto maxIt = map.begin();
+        for(auto it = map.begin(); it != map.end(); it++)
+        {
+            if(it->second > maxIt->second)
+            {
+                maxIt = it;
+            }
+        }
+        return *maxIt;
+    }
+
+
+    /*** Sharded maps ***/
+    /**
+     * @brief A map shared between threads that is split into shards, each a Map guarded by its own std::shared_mutex. Writers only
+     *        lock the shard their key hashes to, and the library functions below scan one shard at a time, so a full scan never
+     *        holds more than one shard's lock and writers to the other shards keep going.
+     * 
+     * Scans over a ShardedMap are weakly consistent: each shard is seen as of the moment its lock is taken, so pairs written to a
+     * shard after it was visited are missed. Use snapshot() for a consistent copy of the whole map.
+     * 
+     * @tparam K The type of keys in the map.
+     * @tparam V The type of values in the map.
+     * @tparam Map The maplike type each shard stores its pairs in.
+     * @tparam ShardHash The hash used to pick a key's shard.
+     */
+    template <typename K, typename V, typename Map = std::unordered_map<K,V>, typename ShardHash = std::hash<K>>
+    class ShardedMap
+    {
+        public:
+            using key_type = K;
+            using mapped_type = V;
+            using shard_type = Map;
+            using size_type = std::size_t;
+
+            /**
+             * @param shardCount The number of shards to split the map into. Defaults to four per hardware thread, which keeps
+             *                   the chance of two threads wanting the same shard low.
+             */
+            explicit ShardedMap(    std::size_t shardCount = 4 * std::max(1u, std::thread::hardware_concurrency())  )
+                : m_shardCount(std::max<std::size_t>(shardCount, 1)), m_shards(new Shard[m_shardCount]) {}
+
+            ShardedMap( const ShardedMap & ) = delete;
+            ShardedMap & operator=( const ShardedMap & ) = delete;
+
+            /**
+             * @brief Sets the value of key, inserting the pair if the map does not contain key.
+             * 
+             * @return True if the pair was inserted, false if an existing value was assigned.
+             */
+            template <typename T>
+            bool insert_or_assign(  const K & key,
+                                    T && value  )
+            {
+                Shard & shard = shardFor(key);
+                std::unique_lock lock(shard.mutex);
+                return shard.map.insert_or_assign(key, std::forward<T>(value)).second;
+            }
+
+            /**
+             * @brief Inserts the pair if the map does not already contain key.
+             * 
+             * @return True if the pair was inserted.
+             */
+            template <typename... ValueArgs>
+            bool try_emplace(   const K & key,
+                                ValueArgs &&... valueArgs   )
+            {
+                Shard & shard = shardFor(key);
+                std::unique_lock lock(shard.mutex);
+                return shard.map.try_emplace(key, std::forward<ValueArgs>(valueArgs)...).second;
+            }
+
+            /**
+             * @brief Calls updater with a reference to key's value while holding its shard's lock, default-constructing the value
+             *        first if key is not in the map. Useful for read-modify-write updates such as counters.
+             */
+            template <typename F>
+            void update(    const K & key,
+                            F && updater    )
+            {
+                Shard & shard = shardFor(key);
+                std::unique_lock lock(shard.mutex);
+                updater(shard.map[key]);
+            }
+
+            size_type erase(    const K & key   )
+            {
+                Shard & shard = shardFor(key);
+                std::unique_lock lock(shard.mutex);
+                return shard.map.erase(key);
+            }
+
+            /**
+             * @brief Returns a copy of key's value, or std::nullopt if the map does not contain key.
+             */
+            std::optional<V> find(  const K & key   ) const
+            {
+                const Shard & shard = shardFor(key);
+                std::shared_lock lock(shard.mutex);
+                auto it = shard.map.find(key);
+                return it == shard.map.end() ? std::nullopt : std::optional<V>(it->second);
+            }
+
+            bool contains(  const K & key   ) const
+            {
+                const Shard & shard = shardFor(key);
+                std::shared_lock lock(shard.mutex);
+                return shard.map.contains(key);
+            }
+
+            /**
+             * @brief The number of pairs in the map, counted one shard at a time.
+             */
+            size_type size() const
+            {
+                size_type size = 0;
+                forEachShard([&](const Map & shard){ size += shard.size(); });
+                return size;
+            }
+
+            bool empty() const
+            {
+                return size() == 0;
+            }
+
+            void clear()
+            {
+                for(std::size_t i = 0; i < m_shardCount; i++)
+                {
+                    std::unique_lock lock(m_shards[i].mutex);
+                    m_shards[i].map.clear();
+                }
+            }
+
+            std::size_t shardCount() const
+            {
+                return m_shardCount;
+            }
+
+            /**
+             * @brief Calls visitor on each shard's map in turn, holding only that shard's shared lock while visitor runs.
+             */
+            template <typename F>
+            void forEachShard(  F && visitor    ) const
+            {
+                for(std::size_t i = 0; i < m_shardCount; i++)
+                {
+                    std::shared_lock lock(m_shards[i].mutex);
+                    visitor(std::as_const(m_shards[i].map));
+                }
+            }
+
+            /**
+             * @brief Calls visitor on the map of shard index while holding its shared lock.
+             */
+            template <typename F>
+            decltype(auto) visitShard(  std::size_t index,
+                                        F && visitor    ) const
+            {
+                std::shared_lock lock(m_shards[index].mutex);
+                return visitor(std::as_const(m_shards[index].map));
+            }
+
+            /**
+             * @brief Copies the whole map into a single Map. Every shard is locked before any is copied, so the copy is a
+             *        consistent view of the map at one moment, at the cost of blocking writers while it is taken.
+             */
+            Map snapshot() const
+            {
+                std::vector< std::shared_lock<std::shared_mutex> > locks;
+                locks.reserve(m_shardCount);
+                size_type size = 0;
+                for(std::size_t i = 0; i < m_shardCount; i++)
+                {
+                    locks.emplace_back(m_shards[i].mutex);
+                    size += m_shards[i].map.size();
+                }
+
+                Map snapshot;
+                if constexpr(requires { snapshot.reserve(size); })
+                {
+                    snapshot.reserve(size);
+                }
+                for(std::size_t i = 0; i < m_shardCount; i++)
+                {
+                    snapshot.insert(m_shards[i].map.begin(), m_shards[i].map.end());
+                }
+                return snapshot;
+            }
+
+        private:
+            struct alignas(64) Shard
+            {
+                mutable std::shared_mutex mutex;
+                Map map;
+            };
+
+            Shard & shardFor(   const K & key   )
+            {
+                return m_shards[shardIndex(key)];
+            }
+
+            const Shard & shardFor( const K & key   ) const
+            {
+                return m_shards[shardIndex(key)];
+            }
+
+            std::size_t shardIndex( const K & key   ) const
+            {
+                //Use the high bits of the scrambled hash, since the shard's own hash table picks buckets with the low bits
+                std::uint64_t hash = static_cast<std::uint64_t>(m_hash(key)) * 0x9E3779B97F4A7C15ULL;
+                return static_cast<std::size_t>((hash >> 32) % m_shardCount);
+            }
+
+            std::size_t m_shardCount;
+            std::unique_ptr<Shard[]> m_shards;
+            ShardHash m_hash;
+    };
+
+
+    /**
+     * @brief Sums the values of a ShardedMap one shard at a time, so no lock is held for longer than it takes to sum one shard.
+     *        The sum is weakly consistent: pairs written to a shard after it was summed are not included.
+     * 
+     * @param map The ShardedMap containing numeric values that we want to sum together.
+     * @param initialValue The value we begin our sum from.
+     * @return The sum of all values in the map added to the initial value.
+     */
+    template <typename K, typename V, typename Map, typename ShardHash>
+    V sumAllValues( const ShardedMap<K,V,Map,ShardHash> & map,
+                    V initialValue = 0  )
+    {
+        V sum = initialValue;
+        map.forEachShard([&](const Map & shard)
+        {
+            for(const auto & [key,value] : shard)
+            {
+                sum += value;
+            }
+        });
+        return sum;
+    }
+
+
+    /**
+     * @brief Gets a vector containing all of the keys of a ShardedMap, copied one shard at a time. Weakly consistent, like
+     *        sumAllValues(const ShardedMap &).
+     */
+    template <typename K, typename V, typename Map, typename ShardHash>
+    std::vector<K> getKeyVector(    const ShardedMap<K,V,Map,ShardHash> & map   )
+    {
+        std::vector<K> keyVector;
+        //Reserved once from a first pass over the shard sizes; writers may change them before the copy, so push_back covers any growth
+        keyVector.reserve(map.size());
+        map.forEachShard([&](const Map & shard)
+        {
+            for(const auto & [key,value] : shard)
+            {
+                keyVector.push_back(key);
+            }
+        });
+        return keyVector;
+    }
+
+
+    /**
+     * @brief Gets a vector containing all of the values of a ShardedMap, copied one shard at a time. Weakly consistent, like
+     *        sumAllValues(const ShardedMap &).
+     */
+    template <typename K, typename V, typename Map, typename ShardHash>
+    std::vector<V> getValueVector(  const ShardedMap<K,V,Map,ShardHash> & map   )
+    {
+        std::vector<V> valueVector;
+        //Reserved once from a first pass over the shard sizes; writers may change them before the copy, so push_back covers any growth
+        valueVector.reserve(map.size());
+        map.forEachShard([&](const Map & shard)
+        {
+            for(const auto & [key,value] : shard)
+            {
+                valueVector.push_back(value);
+            }
+        });
+        return valueVector;
+    }
+
+
+    /**
+     * @brief Gets a random key from a ShardedMap. Shard sizes are read first to pick a shard in proportion to its size, then only
+     *        that shard is locked while the key is found, so every key is about equally likely while writers stay unblocked.
+     * 
+     * @param map - The ShardedMap we are picking a random key from.
+     * @return A random key found in map.
+     */
+    template <typename K, typename V, typename Map, typename ShardHash>
+    K getRandomKey( const ShardedMap<K,V,Map,ShardHash> & map   )
+    {
+        while(true)
+        {
+            std::vector<std::size_t> shardSizes;
+            shardSizes.reserve(map.shardCount());
+            std::size_t totalSize = 0;
+            map.forEachShard([&](const Map & shard)
+            {
+                shardSizes.push_back(shard.size());
+                totalSize += shard.size();
+            });
+            if(totalSize == 0)
+            {
+                throw std::invalid_argument("stevensMapLib::getRandomKey() cannot get a random key from an empty map");
+            }
+
+            //Find the shard holding the chosen position
+            long long int position = rand() % totalSize;
+            std::size_t shardIndex = 0;
+            while(position >= static_cast<long long int>(shardSizes[shardIndex]))
+            {
+                position -= shardSizes[shardIndex];
+                shardIndex++;
+            }
+
+            //The shard may have shrunk since its size was read; if it emptied, choose again
+            std::optional<K> key = map.visitShard(shardIndex, [&](const Map & shard) -> std::optional<K>
+            {
+                if(shard.empty())
+                {
+                    return std::nullopt;
+                }
+                auto it = shard.begin();
+                std::advance(it, position % shard.size());
+                return it->first;
+            });
+            if(key)
+            {
+                return *key;
+            }
+        }
+    }
+
+
+    /*** Concurrent hash maps ***/
+    namespace detail
+    {
+        /**
+         * @brief Epoch-based reclamation for objects shared with lock-free readers. A reader pins the global epoch in a slot
+         *        on its own cache line for as long as it may hold pointers to shared objects. A writer retires an object after
+         *        unlinking it, tagging it with the epoch it was retired in and advancing the epoch, and the object is freed once
+         *        every pinned reader has a later epoch, so no reader can still reach it.
+         */
+        class EpochDomain
+        {
+            static constexpr std::uint64_t IdleEpoch = UINT64_MAX;
+            static constexpr std::size_t SlotCount = 128;
+
+            struct alignas(64) Slot
+            {
+                std::atomic<std::uint64_t> epoch{IdleEpoch};
+            };
+
+            struct Retired
+            {
+                std::uint64_t epoch;
+                void * object;
+                void (*destroy)(void *);
+            };
+
+            public:
+                /**
+                 * @brief Keeps the objects reachable when it was taken from being freed until it is destroyed.
+                 */
+                class Pin
+                {
+                    public:
+                        Pin(    Pin && other    ) : m_slot(std::exchange(other.m_slot, nullptr)) {}
+                        Pin(    const Pin & ) = delete;
+                        Pin & operator=(    const Pin & ) = delete;
+                        Pin & operator=(    Pin && ) = delete;
+
+                        ~Pin()
+                        {
+                            if(m_slot)
+                            {
+                                m_slot->epoch.store(IdleEpoch, std::memory_order_release);
+                            }
+                        }
+
+                    private:
+                        friend class EpochDomain;
+                        explicit Pin(   Slot * slot ) : m_slot(slot) {}
+
+                        Slot * m_slot;
+                };
+
+                /**
+                 * @param scanThreshold How many objects may be retired between scans of the reader slots. Freeing in batches
+                 *        keeps frequent small retirements, like single nodes, from scanning every slot each time.
+                 */
+                explicit EpochDomain(   std::size_t scanThreshold = 1   ) : m_scanThreshold(scanThreshold), m_nextScan(scanThreshold) {}
+
+                EpochDomain(    const EpochDomain & ) = delete;
+                EpochDomain & operator=(    const EpochDomain & ) = delete;
+
+                ~EpochDomain()
+                {
+                    for(const Retired & retired : m_retired)
+                    {
+                        retired.destroy(retired.object);
+                    }
+                }
+
+                /**
+                 * @brief Pins the current epoch for the calling thread. Shared pointers must be loaded after pinning.
+                 */
+                Pin pin() const
+                {
+                    //Each thread starts looking for a free slot at its own position, so a thread usually reuses the same slot
+                    static thread_local std::size_t slotHint = std::hash<std::thread::id>{}(std::this_thread::get_id());
+                    for(std::size_t attempt = 0; ; attempt++)
+                    {
+                        Slot & slot = m_slots[(slotHint + attempt) % SlotCount];
+                        std::uint64_t idle = IdleEpoch;
+                        if(slot.epoch.compare_exchange_strong(idle, m_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst))
+                        {
+                            slotHint = (slotHint + attempt) % SlotCount;
+                            return Pin(&slot);
+                        }
+                        if(attempt % SlotCount == SlotCount - 1)
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+                }
+
+                /**
+                 * @brief Retires objects that have been unlinked, so no reader pinning from now on can reach them, and frees
+                 *        them with delete once no earlier reader can either.
+                 */
+                template <typename T>
+                void retire(    std::span<T * const> objects    )
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    //Readers pinned at or before this epoch may still hold the objects
+                    std::uint64_t retiredEpoch = m_epoch.fetch_add(1, std::memory_order_seq_cst);
+                    for(T * object : objects)
+                    {
+                        m_retired.push_back(Retired{ retiredEpoch, const_cast<void *>(static_cast<const void *>(object)), [](void * retired) { delete static_cast<T *>(retired); } });
+                    }
+                    if(m_retired.size() >= m_nextScan)
+                    {
+                        reclaimLocked();
+                    }
+                }
+
+                template <typename T>
+                void retire(    T * object  )
+                {
+                    retire(std::span<T * const>(&object, 1));
+                }
+
+                /**
+                 * @brief Frees every retired object that no pinned reader can still reach.
+                 */
+                void reclaim()
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    reclaimLocked();
+                }
+
+                /**
+                 * @brief The number of retired objects not freed yet.
+                 */
+                std::size_t pending() const
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    return m_retired.size();
+                }
+
+            private:
+                void reclaimLocked()
+                {
+                    std::uint64_t oldestPinned = IdleEpoch;
+                    for(Slot & slot : m_slots)
+                    {
+                        //A read-modify-write either sees a reader's pin, or is seen by the pin's compare-exchange, which then
+                        //synchronizes with this writer so the reader's later loads see everything unlinked before it
+                        oldestPinned = std::min(oldestPinned, slot.epoch.fetch_add(0, std::memory_order_seq_cst));
+                    }
+                    std::erase_if(m_retired, [&](const Retired & retired)
+                    {
+                        if(retired.epoch < oldestPinned)
+                        {
+                            retired.destroy(retired.object);
+                            return true;
+                        }
+                        return false;
+                    });
+                    m_nextScan = m_retired.size() + m_scanThreshold;
+                }
+
+                std::atomic<std::uint64_t> m_epoch{1};
+                mutable std::array<Slot, SlotCount> m_slots;
+                mutable std::mutex m_mutex;
+                std::vector<Retired> m_retired;
+                std::size_t m_scanThreshold;
+                std::size_t m_nextScan;
+        };
+    }
+
+
+    /**
+     * @brief A hash map for read-heavy sharing between threads. Lookups and iteration take no locks and write only a reader slot
+     *        on their own cache line: each bucket is a singly linked list of immutable nodes that readers follow with acquire
+     *        loads. Writers lock one of a fixed set of stripes, and publish changes by swapping a single pointer, so a reader
+     *        always sees either the old or the new node. Growing the table locks every stripe, builds a new table and publishes
+     *        it the same way.
+     * 
+     * Replaced nodes and old tables are retired rather than freed, because a reader may still be looking at them, and are freed
+     * with the same epoch-based reclamation as SnapshotMap once every reader that could reach them has finished.
+     * 
+     * @tparam K The type of keys in the map.
+     * @tparam V The type of values in the map. Values are copied out of lookups, since a value may be replaced at any time.
+     * @tparam Hash The hash function for keys.
+     * @tparam KeyEqual The equality comparison for keys.
+     */
+    template <typename K, typename V, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+    class ConcurrentHashMap
+    {
+        public:
+            using key_type = K;
+            using mapped_type = V;
+            using size_type = std::size_t;
+
+            /**
+             * @param bucketCount The number of buckets to start with, rounded up to a power of two of at least the stripe count.
+             */
+            explicit ConcurrentHashMap( std::size_t bucketCount = 64    )
+            {
+                std::size_t count = StripeCount;
+                while(count < bucketCount)
+                {
+                    count *= 2;
+                }
+                m_table.store(new Table(count), std::memory_order_relaxed);
+            }
+
+            ConcurrentHashMap(  const ConcurrentHashMap & ) = delete;
+            ConcurrentHashMap & operator=(  const ConcurrentHashMap & ) = delete;
+
+            ~ConcurrentHashMap()
+            {
+                Table * table = m_table.load(std::memory_order_relaxed);
+                for(std::size_t b = 0; b < table->bucketCount; b++)
+                {
+                    Node * node = table->buckets[b].load(std::memory_order_relaxed);
+                    while(node)
+                    {
+                        Node * next = node->next.load(std::memory_order_relaxed);
+                        delete node;
+                        node = next;
+                    }
+                }
+                delete table;
+            }
+
+            /**
+             * @brief Returns a copy of key's value, or std::nullopt if the map does not contain key. Lock-free.
+             */
+            std::optional<V> find(  const K & key   ) const
+            {
+                std::size_t hash = m_hash(key);
+                detail::EpochDomain::Pin pin = m_epochs.pin();
+                const Table * table = m_table.load(std::memory_order_acquire);
+                for(const Node * node = table->bucketFor(hash).load(std::memory_order_acquire); node; node = node->next.load(std::memory_order_acquire))
+                {
+                    if(node->hash == hash && m_equal(node->key, key))
+                    {
+                        return node->value;
+                    }
+                }
+                return std::nullopt;
+            }
+
+            bool contains(  const K & key   ) const
+            {
+                return find(key).has_value();
+            }
+
+            /**
+             * @brief Sets the value of key, inserting the pair if the map does not contain key.
+             * 
+             * @return True if the pair was inserted, false if an existing value was replaced.
+             */
+            bool insert_or_assign(  const K & key,
+                                    const V & value )
+            {
+                return write(key, value, true);
+            }
+
+            /**
+             * @brief Inserts the pair if the map does not already contain key.
+             * 
+             * @return True if the pair was inserted.
+             */
+            bool insert(    const K & key,
+                            const V & value )
+            {
+                return write(key, value, false);
+            }
+
+            size_type erase(    const K & key   )
+            {
+                std::size_t hash = m_hash(key);
+                std::lock_guard<std::mutex> lock(m_stripes[hash % StripeCount].mutex);
+                Table * table = m_table.load(std::memory_order_relaxed);
+                std::atomic<Node*> * link = &table->bucketFor(hash);
+                for(Node * node = link->load(std::memory_order_relaxed); node; node = link->load(std::memory_order_relaxed))
+                {
+                    if(node->hash == hash && m_equal(node->key, key))
+                    {
+                        //Readers already on the node can still follow its next pointer, since it isn't freed until they finish
+                        link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+                        m_size.fetch_sub(1, std::memory_order_relaxed);
+                        retire(node);
+                        return 1;
+                    }
+                    link = &node->next;
+                }
+                return 0;
+            }
+
+            /**
+             * @brief The number of pairs in the map. May be momentarily out of date while other threads write.
+             */
+            size_type size() const
+            {
+                return m_size.load(std::memory_order_relaxed);
+            }
+
+            bool empty() const
+            {
+                return size() == 0;
+            }
+
+            /**
+             * @brief Calls visitor(key, value) for every pair in the map without taking any locks. Safe to run while other
+             *        threads write; pairs inserted or erased during the walk may or may not be visited, but every pair present
+             *        for the whole walk is visited exactly once.
+             */
+            template <typename F>
+            void forEach(   F && visitor    ) const
+            {
+                detail::EpochDomain::Pin pin = m_epochs.pin();
+                const Table * table = m_table.load(std::memory_order_acquire);
+                for(std::size_t b = 0; b < table->bucketCount; b++)
+                {
+                    for(const Node * node = table->buckets[b].load(std::memory_order_acquire); node; node = node->next.load(std::memory_order_acquire))
+                    {
+                        visitor(node->key, node->value);
+                    }
+                }
+            }
+
+            /**
+             * @brief Frees the retired nodes and tables no reader can still reach now, rather than at the next batch. Retired
+             *        memory is freed automatically, so this is only needed to release it sooner. Safe to call at any time.
+             */
+            void reclaim()
+            {
+                m_epochs.reclaim();
+            }
+
+            /**
+             * @brief The number of retired nodes and tables waiting for readers to finish before they are freed.
+             */
+            std::size_t pendingReclamation() const
+            {
+                return m_epochs.pending();
+            }
+
+        private:
+            static constexpr std::size_t StripeCount = 64;
+            static constexpr std::size_t RetireBatch = 256;
+
+            struct Node
+            {
+                const K key;
+                const V value;
+                const std::size_t hash;
+                std::atomic<Node*> next;
+            };
+
+            struct Table
+            {
+                explicit Table( std::size_t count   ) : bucketCount(count), buckets(new std::atomic<Node*>[count]())
+                {
+                    for(std::size_t b = 0; b < count; b++)
+                    {
+                        buckets[b].store(nullptr, std::memory_order_relaxed);
+                    }
+                }
+
+                std::atomic<Node*> & bucketFor( std::size_t hash    ) const
+                {
+                    return buckets[hash & (bucketCount - 1)];
+                }
+
+                std::size_t bucketCount;
+                std::unique_ptr<std::atomic<Node*>[]> buckets;
+            };
+
+            struct alignas(64) Stripe
+            {
+                std::mutex mutex;
+            };
+
+            bool write( const K & key,
+                        const V & value,
+                        bool assign )
+            {
+                std::size_t hash = m_hash(key);
+                bool needsGrowth = false;
+                {
+                    //A key's stripe doesn't depend on the table size, and the table is only swapped while every stripe is held
+                    std::lock_guard<std::mutex> lock(m_stripes[hash % StripeCount].mutex);
+                    Table * table = m_table.load(std::memory_order_relaxed);
+                    std::atomic<Node*> & head = table->bucketFor(hash);
+                    std::atomic<Node*> * link = &head;
+                    for(Node * node = link->load(std::memory_order_relaxed); node; node = link->load(std::memory_order_relaxed))
+                    {
+                        if(node->hash == hash && m_equal(node->key, key))
+                        {
+                            if(assign)
+                            {
+                                //Publish a replacement node in the old one's place
+                                link->store(new Node{key, value, hash, node->next.load(std::memory_order_relaxed)}, std::memory_order_release);
+                                retire(node);
+                            }
+                            return false;
+                        }
+                        link = &node->next;
+                    }
+                    head.store(new Node{key, value, hash, head.load(std::memory_order_relaxed)}, std::memory_order_release);
+                    //Counted under the stripe lock, so an erase of this key can't decrement m_size before it's incremented, and the
+                    //table is read while it can't be swapped and retired
+                    needsGrowth = m_size.fetch_add(1, std::memory_order_relaxed) + 1 > table->bucketCount;
+                }
+
+                if(needsGrowth)
+                {
+                    grow();
+                }
+                return true;
+            }
+
+            void grow()
+            {
+                std::array<std::unique_lock<std::mutex>, StripeCount> locks;
+                for(std::size_t i = 0; i < StripeCount; i++)
+                {
+                    locks[i] = std::unique_lock<std::mutex>(m_stripes[i].mutex);
+                }
+                Table * oldTable = m_table.load(std::memory_order_relaxed);
+                if(m_size.load(std::memory_order_relaxed) <= oldTable->bucketCount)
+                {
+                    return;
+                }
+
+                //Readers may still be walking the old lists, so they are copied rather than relinked
+                std::unique_ptr<Table> newTable = std::make_unique<Table>(oldTable->bucketCount * 2);
+                std::vector<Node*> oldNodes;
+                try
+                {
+                    oldNodes.reserve(m_size.load(std::memory_order_relaxed));
+                    for(std::size_t b = 0; b < oldTable->bucketCount; b++)
+                    {
+                        for(Node * node = oldTable->buckets[b].load(std::memory_order_relaxed); node; node = node->next.load(std::memory_order_relaxed))
+                        {
+                            std::atomic<Node*> & head = newTable->bucketFor(node->hash);
+                            head.store(new Node{node->key, node->value, node->hash, head.load(std::memory_order_relaxed)}, std::memory_order_relaxed);
+                            oldNodes.push_back(node);
+                        }
+                    }
+                }
+                catch(...)
+                {
+                    //The old table is still the live one, so only the copies need freeing
+                    for(std::size_t b = 0; b < newTable->bucketCount; b++)
+                    {
+                        for(Node * node = newTable->buckets[b].load(std::memory_order_relaxed); node; )
+                        {
+                            Node * next = node->next.load(std::memory_order_relaxed);
+                            delete node;
+                            node = next;
+                        }
+                    }
+                    throw;
+                }
+                m_table.store(newTable.release(), std::memory_order_release);
+                m_epochs.retire(std::span<Node * const>(oldNodes));
+                m_epochs.retire(oldTable);
+            }
+
+            void retire(    Node * node )
+            {
+                m_epochs.retire(node);
+            }
+
+            std::atomic<Table*> m_table;
+            std::atomic<std::size_t> m_size{0};
+            std::array<Stripe, StripeCount> m_stripes;
+            Hash m_hash;
+            KeyEqual m_equal;
+            mutable detail::EpochDomain m_epochs{RetireBatch};
+    };
+
+
+    /**
+     * @brief Gets a vector containing all of the keys of a ConcurrentHashMap, without taking any locks.
+     */
+    template <typename K, typename V, typename Hash, typename KeyEqual>
+    std::vector<K> getKeyVector(    const ConcurrentHashMap<K,V,Hash,KeyEqual> & map    )
+    {
+        std::vector<K> keyVector;
+        keyVector.reserve(map.size());
+        map.forEach([&](const K & key, const V &)
+        {
+            keyVector.push_back(key);
+        });
+        return keyVector;
+    }
+
+
+    /**
+     * @brief Gets a vector containing all of the values of a ConcurrentHashMap, without taking any locks.
+     */
+    template <typename K, typename V, typename Hash, typename KeyEqual>
+    std::vector<V> getValueVector(  const ConcurrentHashMap<K,V,Hash,KeyEqual> & map    )
+    {
+        std::vector<V> valueVector;
+        valueVector.reserve(map.size());
+        map.forEach([&](const K &, const V & value)
+        {
+            valueVector.push_back(value);
+        });
+        return valueVector;
+    }
+
+
+    /**
+     * @brief Gets a random key from a ConcurrentHashMap without taking any locks. If pairs are erased while we walk to the
+     *        chosen position, the walk is repeated with the number of pairs actually seen.
+     * 
+     * @param map - The ConcurrentHashMap we are picking a random key from.
+     * @return A random key found in map.
+     */
+    template <typename K, typename V, typename Hash, typename KeyEqual>
+    K getRandomKey( const ConcurrentHashMap<K,V,Hash,KeyEqual> & map    )
+    {
+        std::size_t size = map.size();
+        while(true)
+        {
+            if(size == 0)
+            {
+                throw std::invalid_argument("stevensMapLib::getRandomKey() cannot get a random key from an empty map");
+            }
+            std::size_t position = rand() % size;
+            std::size_t seen = 0;
+            std::optional<K> randomKey;
+            map.forEach([&](const K & key, const V &)
+            {
+                if(seen++ == position)
+                {
+                    randomKey = key;
+                }
+            });
+            if(randomKey)
+            {
+                return *randomKey;
+            }
+            size = seen;
+        }
+    }
+
+
+    /*** Snapshot maps ***/
+    /**
+     * @brief Publishes immutable versions of a map for any number of readers and one writer at a time. A reader pins the current
+     *        version with read() and can then run any library function on it, e.g. sumAllValues(*snapshot), without locking:
+     *        the version never changes under it. The writer applies a batch of changes to a copy of the current version and
+     *        publishes the copy with a single pointer swap, so readers never wait on a reload.
+     * 
+     * Old versions are freed with epoch-based reclamation. Pinning records the global epoch in a reader slot on its own cache
+     * line, and each publish retires the old version and advances the epoch, so a retired version is freed once every pinned
+     * reader has a later epoch.
+     * 
+     * Example: stevensMapLib::SnapshotMap< std::map<std::string,int> > config;
+     *          config.update([](auto & map){ map["style:textColor"] = 1; map["style:backgroundColor"] = 2; });
+     *          auto snapshot = config.read();
+     *          auto styles = stevensMapLib::getPairsWhereKeysStartWith(*snapshot, "style:");
+     * 
+     * @tparam Map The maplike type of each published version.
+     */
+    template <typename Map>
+    class SnapshotMap
+    {
+        public:
+            /**
+             * @brief Keeps one version of the map alive while it is held. Should be released promptly, since versions retired
+             *        after it was pinned can't be freed until it is.
+             */
+            class ReadGuard
+            {
+                public:
+                    ReadGuard(  ReadGuard && other  ) = default;
+                    ReadGuard(  const ReadGuard & ) = delete;
+                    ReadGuard & operator=(  const ReadGuard & ) = delete;
+                    ReadGuard & operator=(  ReadGuard && ) = delete;
+
+                    const Map & operator*() const { return *m_map; }
+                    const Map * operator->() const { return m_map; }
+                    const Map & get() const { return *m_map; }
+
+                private:
+                    friend class SnapshotMap;
+                    ReadGuard(  detail::EpochDomain::Pin pin,
+                                const Map * map ) : m_pin(std::move(pin)), m_map(map) {}
+
+                    detail::EpochDomain::Pin m_pin;
+                    const Map * m_map;
+            };
+
+            explicit SnapshotMap(   Map initial = Map() ) : m_current(new Map(std::move(initial))) {}
+
+            SnapshotMap(    const SnapshotMap & ) = delete;
+            SnapshotMap & operator=(    const SnapshotMap & ) = delete;
+
+            ~SnapshotMap()
+            {
+                delete m_current.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Pins and returns the current version of the map.
+             */
+            ReadGuard read() const
+            {
+                //Pinning before loading the version means a writer that misses our pin swapped the version first
+                detail::EpochDomain::Pin pin = m_epochs.pin();
+                return ReadGuard(std::move(pin), m_current.load(std::memory_order_seq_cst));
+            }
+
+            /**
+             * @brief Applies a batch of changes and publishes them as the new version. mutator is called with a copy of the
+             *        current version, which readers can't see until mutator returns. Writers are serialized.
+             * 
+             * @param mutator A callable taking Map &.
+             */
+            template <typename F>
+            void update(    F && mutator    )
+            {
+                std::lock_guard<std::mutex> lock(m_writerMutex);
+                Map * next = new Map(*m_current.load(std::memory_order_relaxed));
+                try
+                {
+                    mutator(*next);
+                }
+                catch(...)
+                {
+                    delete next;
+                    throw;
+                }
+                publishLocked(next);
+            }
+
+            /**
+             * @brief Replaces the whole map with newVersion, e.g. after reloading it from its source.
+             */
+            void publish(   Map newVersion  )
+            {
+                std::lock_guard<std::mutex> lock(m_writerMutex);
+                publishLocked(new Map(std::move(newVersion)));
+            }
+
+            /**
+             * @brief The number of versions published so far.
+             */
+            std::uint64_t version() const
+            {
+                return m_version.load(std::memory_order_relaxed);
+            }
+
+        private:
+            void publishLocked( Map * next  )
+            {
+                const Map * previous = m_current.exchange(next, std::memory_order_seq_cst);
+                m_version.fetch_add(1, std::memory_order_relaxed);
+                m_epochs.retire(previous);
+            }
+
+            std::atomic<const Map*> m_current;
+            std::atomic<std::uint64_t> m_version{0};
+            mutable detail::EpochDomain m_epochs;
+            std::mutex m_writerMutex;
+    };
+
+
+    /*** Memory-mapped maps ***/
+#if __has_include(<sys/mman.h>)
+    namespace detail
+    {
+        /**
+         * @brief The header at the start of a file written by writeMappedMap().
+         */
+        struct MappedMapHeader
+        {
+            char magic[8];
+            std::uint32_t formatVersion;
+            std::uint32_t flags;
+            std::uint64_t count;
+            std::uint32_t keySize;
+            std::uint32_t valueSize;
+            std::uint64_t valuesOffset;
+            std::uint64_t keysOffset;
+            std::uint64_t keyBytesOffset;
+            std::uint64_t fileSize;
+        };
+
+        inline constexpr char MappedMapMagic[8] = { 'S', 'M', 'L', 'M', 'M', 'A', 'P', '\0' };
+        inline constexpr std::uint32_t MappedMapFormatVersion = 1;
+        inline constexpr std::uint32_t MappedMapStringKeys = 1;
+        inline constexpr std::uint32_t MappedMapBigEndian = 2;
+
+        inline constexpr std::uint32_t nativeEndianFlag()
+        {
+            return std::endian::native == std::endian::big ? MappedMapBigEndian : 0;
+        }
+
+        inline constexpr std::uint64_t alignOffset( std::uint64_t offset,
+                                                    std::uint64_t alignment )
+        {
+            return (offset + alignment - 1) / alignment * alignment;
+        }
+
+        //Whether count elements of elementSize bytes starting at offset lie within a file of fileSize bytes, computed without overflowing
+        inline constexpr bool regionFits(   std::uint64_t offset,
+                                            std::uint64_t count,
+                                            std::uint64_t elementSize,
+                                            std::uint64_t fileSize  )
+        {
+            return offset <= fileSize && (elementSize == 0 || count <= (fileSize - offset) / elementSize);
+        }
+
+        /**
+         * @brief A read-only mapping of a whole file, unmapped when the last view using it goes away.
+         */
+        class FileMapping
+        {
+            public:
+                explicit FileMapping(   const std::string & path    )
+                {
+                    int fd = ::open(path.c_str(), O_RDONLY);
+                    if(fd < 0)
+                    {
+                        throw std::runtime_error("stevensMapLib::MappedMapView could not open " + path);
+                    }
+                    struct stat status;
+                    if(::fstat(fd, &status) != 0)
+                    {
+                        ::close(fd);
+                        throw std::runtime_error("stevensMapLib::MappedMapView could not read the size of " + path);
+                    }
+                    m_size = static_cast<std::size_t>(status.st_size);
+                    if(m_size > 0)
+                    {
+                        void * data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+                        if(data == MAP_FAILED)
+                        {
+                            ::close(fd);
+                            throw std::runtime_error("stevensMapLib::MappedMapView could not map " + path);
+                        }
+                        m_data = static_cast<const char *>(data);
+                    }
+                    ::close(fd);
+                }
+
+                FileMapping(    const FileMapping & ) = delete;
+                FileMapping & operator=(    const FileMapping & ) = delete;
+
+                ~FileMapping()
+                {
+                    if(m_data)
+                    {
+                        ::munmap(const_cast<char *>(m_data), m_size);
+                    }
+                }
+
+                const char * data() const { return m_data; }
+                std::size_t size() const { return m_size; }
+
+            private:
+                const char * m_data = nullptr;
+                std::size_t m_size = 0;
+        };
+    }
+
+
+    /**
+     * @brief Writes a maplike object to a file that MappedMapView can map and query in place. Pairs are stored sorted by key,
+     *        with values in one contiguous array and keys in another (string keys as an offset array plus their characters),
+     *        so opening the file needs no parsing at all.
+     * 
+     * @tparam M The maplike type we are writing. Its keys must be stringlike or trivially copyable, and its values trivially copyable.
+     * @param path The file to write.
+     * @param map The maplike object we are writing.
+     */
+    template <typename M>
+    void writeMappedMap(    const std::string & path,
+                            const M & map   )
+    {
+        using K = std::remove_cvref_t<decltype(map.begin()->first)>;
+        using V = std::remove_cvref_t<decltype(map.begin()->second)>;
+        constexpr bool stringKeys = std::is_convertible_v<const K &, std::string_view>;
+        static_assert(std::is_trivially_copyable_v<V>, "stevensMapLib::writeMappedMap() requires trivially copyable values");
+        static_assert(stringKeys || std::is_trivially_copyable_v<K>, "stevensMapLib::writeMappedMap() requires stringlike or trivially copyable keys");
+
+        //Sort the pairs by key, comparing string keys by their bytes so readers can binary search them the same way
+        std::vector<const typename M::value_type *> pairs;
+        pairs.reserve(map.size());
+        for(const auto & pair : map)
+        {
+            pairs.push_back(&pair);
+        }
+        std::sort(pairs.begin(), pairs.end(), [](const auto * a, const auto * b)
+        {
+            if constexpr(stringKeys)
+            {
+                return std::string_view(a->first) < std::string_view(b->first);
+            }
+            else
+            {
+                return a->first < b->first;
+            }
+        });
+
+        detail::MappedMapHeader header = {};
+        std::memcpy(header.magic, detail::MappedMapMagic, sizeof(header.magic));
+        header.formatVersion = detail::MappedMapFormatVersion;
+        header.flags = (stringKeys ? detail::MappedMapStringKeys : 0) | detail::nativeEndianFlag();
+        header.count = pairs.size();
+        header.keySize = stringKeys ? 0 : sizeof(K);
+        header.valueSize = sizeof(V);
+        header.valuesOffset = detail::alignOffset(sizeof(header), 64);
+        header.keysOffset = detail::alignOffset(header.valuesOffset + header.count * sizeof(V), 64);
+        std::uint64_t keyBytes = 0;
+        if constexpr(stringKeys)
+        {
+            for(const auto * pair : pairs)
+            {
+                keyBytes += std::string_view(pair->first).size();
+            }
+            header.keyBytesOffset = header.keysOffset + (header.count + 1) * sizeof(std::uint64_t);
+        }
+        else
+        {
+            header.keyBytesOffset = header.keysOffset + header.count * sizeof(K);
+        }
+        header.fileSize = header.keyBytesOffset + keyBytes;
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if(!file)
+        {
+            throw std::runtime_error("stevensMapLib::writeMappedMap() could not open " + path);
+        }
+        auto padTo = [&](std::uint64_t offset)
+        {
+            static constexpr char zeros[64] = {};
+            file.write(zeros, static_cast<std::streamsize>(offset - static_cast<std::uint64_t>(file.tellp())));
+        };
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        padTo(header.valuesOffset);
+        for(const auto * pair : pairs)
+        {
+            file.write(reinterpret_cast<const char *>(&pair->second), sizeof(V));
+        }
+        padTo(header.keysOffset);
+        if constexpr(stringKeys)
+        {
+            std::uint64_t offset = 0;
+            file.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+            for(const auto * pair : pairs)
+            {
+                offset += std::string_view(pair->first).size();
+                file.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+            }
+            for(const auto * pair : pairs)
+            {
+                std::string_view key = pair->first;
+                file.write(key.data(), static_cast<std::streamsize>(key.size()));
+            }
+        }
+        else
+        {
+            for(const auto * pair : pairs)
+            {
+                file.write(reinterpret_cast<const char *>(&pair->first), sizeof(K));
+            }
+        }
+        if(!file.flush())
+        {
+            throw std::runtime_error("stevensMapLib::writeMappedMap() could not write " + path);
+        }
+    }
+
+
+    /**
+     * @brief A read-only, sorted maplike view of a file written by writeMappedMap(), queried directly in the memory-mapped file.
+     *        Opening a view maps the file and checks its header; nothing is deserialized, so a view of any size opens in about
+     *        the time it takes to map it. Lookups are binary searches, and views are cheap to copy, sharing the mapping.
+     * 
+     * Iterating yields std::pair<K,V> by value. String keys are std::string_views pointing into the mapped file, valid as long as
+     * any view of the file exists.
+     * 
+     * Example: stevensMapLib::MappedMapView<std::string_view,double> weights("weights.smlmap");
+     *          double total = stevensMapLib::sumAllValues(weights);
+     * 
+     * @tparam K The type of keys: std::string_view for files written from stringlike keys, or the trivially copyable key type.
+     * @tparam V The trivially copyable type of values.
+     */
+    template <typename K, typename V>
+    class MappedMapView
+    {
+        static constexpr bool StringKeys = std::is_same_v<K, std::string_view>;
+
+        public:
+            using key_type = K;
+            using mapped_type = V;
+            using value_type = std::pair<K,V>;
+            using size_type = std::size_t;
+            //writeMappedMap() sorts the keys with <, comparing string keys by their bytes, which is what std::less<std::string_view> does
+            using key_compare = std::less<K>;
+
+            //A proxy iterator: it yields pairs by value, so legacy algorithms can only rely on it as an input iterator, while
+            //C++20 algorithms and concepts see it as random access, like the standard library's own proxy iterators
+            class const_iterator
+            {
+                public:
+                    using iterator_category = std::input_iterator_tag;
+                    using iterator_concept = std::random_access_iterator_tag;
+                    using value_type = std::pair<K,V>;
+                    using difference_type = std::ptrdiff_t;
+                    using reference = value_type;
+
+                    struct pointer
+                    {
+                        value_type pair;
+                        const value_type * operator->() const { return &pair; }
+                    };
+
+                    const_iterator() = default;
+
+                    value_type operator*() const { return { m_view->keyAt(m_index), m_view->valueAt(m_index) }; }
+                    pointer operator->() const { return { **this }; }
+                    value_type operator[](  difference_type n   ) const { return *(*this + n); }
+
+                    const_iterator & operator++() { m_index++; return *this; }
+                    const_iterator operator++(int) { const_iterator copy = *this; m_index++; return copy; }
+                    const_iterator & operator--() { m_index--; return *this; }
+                    const_iterator operator--(int) { const_iterator copy = *this; m_index--; return copy; }
+                    const_iterator & operator+=(    difference_type n   ) { m_index += n; return *this; }
+                    const_iterator & operator-=(    difference_type n   ) { m_index -= n; return *this; }
+                    friend const_iterator operator+(    const_iterator it, difference_type n    ) { return it += n; }
+                    friend const_iterator operator+(    difference_type n, const_iterator it    ) { return it += n; }
+                    friend const_iterator operator-(    const_iterator it, difference_type n    ) { return it -= n; }
+                    friend difference_type operator-(   const const_iterator & a, const const_iterator & b  ) { return static_cast<difference_type>(a.m_index) - static_cast<difference_type>(b.m_index); }
+                    friend bool operator==( const const_iterator & a, const const_iterator & b  ) { return a.m_index == b.m_index; }
+                    friend auto operator<=>(    const const_iterator & a, const const_iterator & b  ) { return a.m_index <=> b.m_index; }
+
+                    std::size_t index() const { return m_index; }
+
+                private:
+                    friend class MappedMapView;
+                    const_iterator( const MappedMapView * view,
+                                    std::size_t index   ) : m_view(view), m_index(index) {}
+
+                    const MappedMapView * m_view = nullptr;
+                    std::size_t m_index = 0;
+            };
+            using iterator = const_iterator;
+
+            /**
+             * @brief Maps the file at path. Throws std::runtime_error if the file can't be mapped, was not written by
+             *        writeMappedMap() with matching key and value types on a machine of the same endianness, or has a header
+             *        whose regions don't fit in the file.
+             */
+            explicit MappedMapView( const std::string & path    ) : m_mapping(std::make_shared<detail::FileMapping>(path))
+            {
+                const detail::MappedMapHeader * header = reinterpret_cast<const detail::MappedMapHeader *>(m_mapping->data());
+                std::uint64_t fileSize = m_mapping->size();
+                bool valid = fileSize >= sizeof(detail::MappedMapHeader) &&
+                             std::memcmp(header->magic, detail::MappedMapMagic, sizeof(header->magic)) == 0 &&
+                             header->formatVersion == detail::MappedMapFormatVersion &&
+                             header->flags == ((StringKeys ? detail::MappedMapStringKeys : 0) | detail::nativeEndianFlag()) &&
+                             header->keySize == (StringKeys ? 0 : sizeof(K)) &&
+                             header->valueSize == sizeof(V) &&
+                             header->fileSize == fileSize;
+                //Every region the view reads must lie within the mapping, so a damaged header can't lead to reads past its end
+                valid = valid &&
+                        header->valuesOffset % alignof(V) == 0 &&
+                        detail::regionFits(header->valuesOffset, header->count, sizeof(V), fileSize) &&
+                        header->keyBytesOffset <= fileSize;
+                if constexpr(StringKeys)
+                {
+                    valid = valid &&
+                            header->count < UINT64_MAX &&
+                            detail::regionFits(header->keysOffset, header->count + 1, sizeof(std::uint64_t), fileSize);
+                    if(valid)
+                    {
+                        //The last offset is the total length of the keys; keyAt() checks the offsets of each key it reads
+                        std::uint64_t keyByteCount;
+                        std::memcpy(&keyByteCount, m_mapping->data() + header->keysOffset + header->count * sizeof(std::uint64_t), sizeof(keyByteCount));
+                        m_keyByteCount = fileSize - header->keyBytesOffset;
+                        valid = keyByteCount <= m_keyByteCount;
+                    }
+                }
+                else
+                {
+                    valid = valid && detail::regionFits(header->keysOffset, header->count, sizeof(K), fileSize);
+                }
+                if(!valid)
+                {
+                    throw std::runtime_error("stevensMapLib::MappedMapView cannot read " + path + " as a map of the requested types");
+                }
+                m_values = reinterpret_cast<const V *>(m_mapping->data() + header->valuesOffset);
+                m_keys = m_mapping->data() + header->keysOffset;
+                m_keyBytes = m_mapping->data() + header->keyBytesOffset;
+                m_last = header->count;
+            }
+
+            const_iterator begin() const { return const_iterator(this, m_first); }
+            const_iterator end() const { return const_iterator(this, m_last); }
+            size_type size() const { return m_last - m_first; }
+            bool empty() const { return m_first == m_last; }
+            key_compare key_comp() const { return key_compare(); }
+
+            K keyAt(    std::size_t index   ) const
+            {
+                if constexpr(StringKeys)
+                {
+                    std::uint64_t offsets[2];
+                    std::memcpy(offsets, m_keys + index * sizeof(std::uint64_t), sizeof(offsets));
+                    if(offsets[0] > offsets[1] || offsets[1] > m_keyByteCount)
+                    {
+                        throw std::runtime_error("stevensMapLib::MappedMapView found a key outside the key bytes of its file");
+                    }
+                    return std::string_view(m_keyBytes + offsets[0], offsets[1] - offsets[0]);
+                }
+                else
+                {
+                    K key;
+                    std::memcpy(&key, m_keys + index * sizeof(K), sizeof(K));
+                    return key;
+                }
+            }
+
+            const V & valueAt(  std::size_t index   ) const
+            {
+                return m_values[index];
+            }
+
+            /**
+             * @brief The values of the view in key order, as a contiguous array in the mapped file.
+             */
+            std::span<const V> values() const
+            {
+                return std::span<const V>(m_values + m_first, size());
+            }
+
+            /**
+             * @brief Finds the first pair whose key is not less than key, with a binary search.
+             */
+            const_iterator lower_bound( const K & key   ) const
+            {
+                std::size_t low = m_first;
+                std::size_t high = m_last;
+                while(low < high)
+                {
+                    std::size_t middle = low + (high - low) / 2;
+                    if(keyAt(middle) < key)
+                    {
+                        low = middle + 1;
+                    }
+                    else
+                    {
+                        high = middle;
+                    }
+                }
+                return const_iterator(this, low);
+            }
+
+            const_iterator find(    const K & key   ) const
+            {
+                const_iterator it = lower_bound(key);
+                return it != end() && keyAt(it.index()) == key ? it : end();
+            }
+
+            bool contains(  const K & key   ) const
+            {
+                return find(key) != end();
+            }
+
+            V at(   const K & key   ) const
+            {
+                const_iterator it = find(key);
+                if(it == end())
+                {
+                    throw std::out_of_range("stevensMapLib::MappedMapView::at() could not find the requested key");
+                }
+                return valueAt(it.index());
+            }
+
+            /**
+             * @brief A view of the pairs from first up to last, sharing this view's mapping.
+             */
+            MappedMapView subview(  const_iterator first,
+                                    const_iterator last ) const
+            {
+                MappedMapView view = *this;
+                view.m_first = first.index();
+                view.m_last = last.index();
+                return view;
+            }
+
+        private:
+            std::shared_ptr<const detail::FileMapping> m_mapping;
+            const V * m_values = nullptr;
+            const char * m_keys = nullptr;
+            const char * m_keyBytes = nullptr;
+            std::uint64_t m_keyByteCount = 0;
+            std::size_t m_first = 0;
+            std::size_t m_last = 0;
+    };
+
+
+    /**
+     * @brief Gets a vector containing all of the keys of a MappedMapView in sorted order. String keys are views into the
+     *        mapped file, so no key characters are copied.
+     */
+    template <typename K, typename V>
+    std::vector<K> getKeyVector(    const MappedMapView<K,V> & map  )
+    {
+        std::vector<K> keyVector;
+        keyVector.reserve(map.size());
+        for(std::size_t i = map.begin().index(); i < map.end().index(); i++)
+        {
+            keyVector.push_back(map.keyAt(i));
+        }
+        return keyVector;
+    }
+
+
+    /**
+     * @brief Returns the pairs of a MappedMapView whose keys begin with str. Since the keys are sorted, the pairs are found with
+     *        two binary searches and returned as a subview of map, without copying anything.
+     * 
+     * @param map - The MappedMapView with string keys we are extracting key-value pairs from.
+     * @param str - Stringlike string of characters we want all of the keys in our resulting view to start with.
+     * @return A MappedMapView of the pairs of map whose keys start with str.
+     */
+    template <typename V, typename S>
+    MappedMapView<std::string_view,V> getPairsWhereKeysStartWith(   const MappedMapView<std::string_view,V> & map,
+                                                                    const S & str   )
+    {
+        std::string_view prefix = detail::keyView(str);
+        auto first = map.lower_bound(prefix);
+        auto last = std::ranges::partition_point(first, map.end(), [&](const std::pair<std::string_view,V> & pair)
+        {
+            return pair.first.starts_with(prefix);
+        });
+        return map.subview(first, last);
+    }
+
+
+    /**
+     * @brief Returns the pair of a MappedMapView with the greatest key, which is its last pair.
+     */
+    template <typename K, typename V>
+    std::pair<K,V> getPairWithMaxKey(   const MappedMapView<K,V> & map  )
+    {
+        if(map.empty())
+        {
+            throw std::invalid_argument("stevensMapLib::getPairWithMaxKey() cannot get a pair from an empty map");
+        }
+        return *std::ranges::prev(map.end());
+    }
+
+
+    /**
+     * @brief Sums the values of a MappedMapView, reading them straight from their contiguous array in the mapped file.
+     */
+    template <typename K, typename V>
+    V sumAllValues( const MappedMapView<K,V> & map,
+                    V initialValue = 0  )
+    {
+        V sum = initialValue;
+        for(const V & value : map.values())
+        {
+            sum += value;
+        }
+        return sum;
+    }
+#endif
+
+
+    /*** Binary serialization ***/
+    namespace detail
+    {
+        inline constexpr char BinaryMapMagic[8] = { 'S', 'M', 'L', 'B', 'I', 'N', '\0', '\0' };
+        inline constexpr std::uint16_t BinaryMapFormatVersion = 1;
+        inline constexpr std::uint16_t BinaryMapSorted = 1;
+        inline constexpr std::uint16_t BinaryMapBigEndian = 2;
+        inline constexpr std::uint8_t BinaryFixedCodec = 0;
+        inline constexpr std::uint8_t BinaryStringCodec = 1;
+
+        /**
+         * @brief The header at the start of a stream written by BinaryMapWriter.
+         */
+        struct BinaryMapHeader
+        {
+            char magic[8];
+            std::uint16_t formatVersion;
+            std::uint16_t flags;
+            std::uint8_t keyCodec;
+            std::uint8_t valueCodec;
+            std::uint16_t reserved;
+            std::uint32_t keySize;
+            std::uint32_t valueSize;
+            std::uint64_t count;
+        };
+
+        /**
+         * @brief Stringlike types are written as a 64-bit length followed by their characters, and trivially copyable types as
+         *        their bytes.
+         */
+        template <typename T>
+        constexpr bool isBinaryString = std::is_convertible_v<const T &, std::string_view>;
+
+        template <typename T>
+        constexpr std::uint8_t binaryCodec()
+        {
+            static_assert(isBinaryString<T> || std::is_trivially_copyable_v<T>, "stevensMapLib binary serialization requires stringlike or trivially copyable keys and values");
+            return isBinaryString<T> ? BinaryStringCodec : BinaryFixedCodec;
+        }
+
+        template <typename T>
+        constexpr std::uint32_t binarySize()
+        {
+            return isBinaryString<T> ? 1 : sizeof(T);
+        }
+
+        /**
+         * @brief Adds a loaded pair to a map, replacing the value of a key the map already has. Ordered maps get a hint at the
+         *        end so that sorted input is inserted in constant time per pair.
+         */
+        template <typename Map, typename K, typename V>
+        void insertLoaded(  Map & map,
+                            K && key,
+                            V && value  )
+        {
+            if constexpr(requires { map.key_comp(); map.insert_or_assign(map.end(), std::move(key), std::move(value)); })
+            {
+                map.insert_or_assign(map.end(), std::move(key), std::move(value));
+            }
+            else
+            {
+                map.insert_or_assign(std::move(key), std::move(value));
+            }
+        }
+    }
+
+
+    /**
+     * @brief Writes key-value pairs to a binary stream: a versioned header followed by one record per pair. Records are packed
+     *        into a large buffer and handed to the stream a buffer at a time. Fixed-size keys and values are copied as raw
+     *        bytes, and stringlike ones are length-prefixed.
+     * 
+     * @tparam K The type of keys written. Must be stringlike or trivially copyable.
+     * @tparam V The type of values written. Must be stringlike or trivially copyable.
+     */
+    template <typename K, typename V>
+    class BinaryMapWriter
+    {
+        public:
+            static constexpr std::uint64_t UnknownCount = UINT64_MAX;
+
+            /**
+             * @param stream The binary stream to write to.
+             * @param sorted Whether the pairs will be written in increasing key order, which lets readers insert them into
+             *               ordered maps with hints, and lets mergeSortedMapFiles() stream them.
+             * @param count The number of pairs that will be written, if known. Otherwise the count is filled in by finish() when
+             *              the stream is seekable, and readers read until the end of the stream when it is not.
+             */
+            explicit BinaryMapWriter(   std::ostream & stream,
+                                        bool sorted = false,
+                                        std::uint64_t count = UnknownCount  ) : m_stream(stream), m_headerPosition(stream.tellp()), m_expectedCount(count)
+            {
+                m_buffer.reserve(BufferSize);
+                detail::BinaryMapHeader header = {};
+                std::memcpy(header.magic, detail::BinaryMapMagic, sizeof(header.magic));
+                header.formatVersion = detail::BinaryMapFormatVersion;
+                header.flags = (sorted ? detail::BinaryMapSorted : 0) | (std::endian::native == std::endian::big ? detail::BinaryMapBigEndian : 0);
+                header.keyCodec = detail::binaryCodec<K>();
+                header.valueCodec = detail::binaryCodec<V>();
+                header.keySize = detail::binarySize<K>();
+                header.valueSize = detail::binarySize<V>();
+                header.count = count;
+                put(&header, sizeof(header));
+            }
+
+            BinaryMapWriter(    const BinaryMapWriter & ) = delete;
+            BinaryMapWriter & operator=(    const BinaryMapWriter & ) = delete;
+
+            ~BinaryMapWriter()
+            {
+                if(!m_finished)
+                {
+                    try
+                    {
+                        finish();
+                    }
+                    catch(...)
+                    {
+                    }
+                }
+            }
+
+            void write( const K & key,
+                        const V & value )
+            {
+                putField(key);
+                putField(value);
+                m_written++;
+            }
+
+            /**
+             * @brief Flushes the buffered records and fills in the header's count if it was not given up front. Throws
+             *        std::runtime_error if the stream fails, or std::logic_error if a different number of pairs was written
+             *        than the count given to the constructor.
+             */
+            void finish()
+            {
+                m_finished = true;
+                flushBuffer();
+                if(m_expectedCount == UnknownCount)
+                {
+                    if(m_headerPosition != std::streampos(-1))
+                    {
+                        std::streampos end = m_stream.tellp();
+                        m_stream.seekp(m_headerPosition + static_cast<std::streamoff>(offsetof(detail::BinaryMapHeader, count)));
+                        m_stream.write(reinterpret_cast<const char *>(&m_written), sizeof(m_written));
+                        m_stream.seekp(end);
+                    }
+                }
+                else if(m_expectedCount != m_written)
+                {
+                    throw std::logic_error("stevensMapLib::BinaryMapWriter wrote a different number of pairs than it was told to expect");
+                }
+                if(!m_stream.flush())
+                {
+                    throw std::runtime_error("stevensMapLib::BinaryMapWriter could not write to its stream");
+                }
+            }
+
+            std::uint64_t written() const
+            {
+                return m_written;
+            }
+
+        private:
+            static constexpr std::size_t BufferSize = 1 << 16;
+
+            template <typename T>
+            void putField(  const T & field )
+            {
+                if constexpr(detail::isBinaryString<T>)
+                {
+                    std::string_view str = field;
+                    std::uint64_t length = str.size();
+                    put(&length, sizeof(length));
+                    put(str.data(), str.size());
+                }
+                else
+                {
+                    put(&field, sizeof(T));
+                }
+            }
+
+            void put(   const void * data,
+                        std::size_t size    )
+            {
+                if(m_buffer.size() + size > BufferSize)
+                {
+                    flushBuffer();
+                    if(size > BufferSize)
+                    {
+                        m_stream.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+                        return;
+                    }
+                }
+                const char * bytes = static_cast<const char *>(data);
+                m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+            }
+
+            void flushBuffer()
+            {
+                m_stream.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+                m_buffer.clear();
+                if(!m_stream)
+                {
+                    throw std::runtime_error("stevensMapLib::BinaryMapWriter could not write to its stream");
+                }
+            }
+
+            std::ostream & m_stream;
+            std::streampos m_headerPosition;
+            std::uint64_t m_expectedCount;
+            std::uint64_t m_written = 0;
+            bool m_finished = false;
+            std::vector<char> m_buffer;
+    };
+
+
+    /**
+     * @brief Reads key-value pairs written by BinaryMapWriter, one record at a time, through a large read buffer. The reader
+     *        reads ahead from the stream, so the stream should not be read from elsewhere while the reader is in use.
+     * 
+     * @tparam K The type of keys to read, matching the type they were written from. Stringlike keys can be read into any
+     *           std::basic_string<char> or InternedString (interned into the global pool).
+     * @tparam V The type of values to read.
+     */
+    template <typename K, typename V>
+    class BinaryMapReader
+    {
+        public:
+            static constexpr std::uint64_t UnknownCount = UINT64_MAX;
+
+            /**
+             * @brief Reads and checks the header. Throws std::runtime_error if the stream does not hold pairs of the requested
+             *        types written by this version of the format on a machine of the same endianness.
+             */
+            explicit BinaryMapReader(   std::istream & stream   ) : m_stream(stream), m_buffer(BufferSize)
+            {
+                detail::BinaryMapHeader header;
+                bool valid = get(&header, sizeof(header)) &&
+                             std::memcmp(header.magic, detail::BinaryMapMagic, sizeof(header.magic)) == 0 &&
+                             header.formatVersion == detail::BinaryMapFormatVersion &&
+                             (header.flags & detail::BinaryMapBigEndian) == (std::endian::native == std::endian::big ? detail::BinaryMapBigEndian : 0) &&
+                             header.keyCodec == detail::binaryCodec<K>() &&
+                             header.valueCodec == detail::binaryCodec<V>() &&
+                             header.keySize == detail::binarySize<K>() &&
+                             header.valueSize == detail::binarySize<V>();
+                if(!valid)
+                {
+                    throw std::runtime_error("stevensMapLib::BinaryMapReader cannot read its stream as a map of the requested types");
+                }
+                m_count = header.count;
+                m_sorted = header.flags & detail::BinaryMapSorted;
+            }
+
+            /**
+             * @brief The number of pairs in the stream, or UnknownCount if the writer could not record it.
+             */
+            std::uint64_t count() const
+            {
+                return m_count;
+            }
+
+            bool sorted() const
+            {
+                return m_sorted;
+            }
+
+            /**
+             * @brief Reads the next pair into key and value.
+             * 
+             * @return False once every pair has been read. Throws std::runtime_error if the stream ends partway through a pair.
+             */
+            bool next(  K & key,
+                        V & value   )
+            {
+                if(m_read == m_count || (m_count == UnknownCount && atEnd()))
+                {
+                    return false;
+                }
+                if(!getField(key) || !getField(value))
+                {
+                    throw std::runtime_error("stevensMapLib::BinaryMapReader reached the end of its stream partway through a pair");
+                }
+                m_read++;
+                return true;
+            }
+
+        private:
+            static constexpr std::size_t BufferSize = 1 << 16;
+
+            template <typename T>
+            bool getField(  T & field   )
+            {
+                if constexpr(detail::isBinaryString<T>)
+                {
+                    std::uint64_t length;
+                    if(!get(&length, sizeof(length)))
+                    {
+                        return false;
+                    }
+                    if constexpr(std::is_same_v<T, InternedString>)
+                    {
+                        bool complete = getString(m_scratch, length);
+                        field = StringPool::global().intern(m_scratch);
+                        return complete;
+                    }
+                    else
+                    {
+                        return getString(field, length);
+                    }
+                }
+                else
+                {
+                    return get(&field, sizeof(T));
+                }
+            }
+
+            //Grows str only as its bytes arrive, so a corrupt length can't make us allocate more than the stream holds
+            template <typename S>
+            bool getString( S & str,
+                            std::uint64_t length    )
+            {
+                str.clear();
+                if(length > str.max_size())
+                {
+                    return false;
+                }
+                while(length > 0)
+                {
+                    if(m_position == m_filled && !refill())
+                    {
+                        return false;
+                    }
+                    std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(length, m_filled - m_position));
+                    str.append(m_buffer.data() + m_position, chunk);
+                    m_position += chunk;
+                    length -= chunk;
+                }
+                return true;
+            }
+
+            bool atEnd()
+            {
+                return m_position == m_filled && !refill();
+            }
+
+            bool refill()
+            {
+                m_position = 0;
+                m_filled = static_cast<std::size_t>(m_stream.rdbuf()->sgetn(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size())));
+                return m_filled > 0;
+            }
+
+            bool get(   void * data,
+                        std::size_t size    )
+            {
+                char * bytes = static_cast<char *>(data);
+                while(size > 0)
+                {
+                    if(m_position == m_filled && !refill())
+                    {
+                        return false;
+                    }
+                    std::size_t chunk = std::min(size, m_filled - m_position);
+                    std::memcpy(bytes, m_buffer.data() + m_position, chunk);
+                    m_position += chunk;
+                    bytes += chunk;
+                    size -= chunk;
+                }
+                return true;
+            }
+
+            std::istream & m_stream;
+            std::vector<char> m_buffer;
+            std::size_t m_position = 0;
+            std::size_t m_filled = 0;
+            std::uint64_t m_count = 0;
+            std::uint64_t m_read = 0;
+            bool m_sorted = false;
+            std::string m_scratch;
+    };
+
+
+    /**
+     * @brief Writes every pair of a maplike object to a binary stream that readMapBinary() can load. Pairs from maps ordered
+     *        by std::less are flagged as sorted.
+     * 
+     * Example: std::ofstream file("counts.smlbin", std::ios::binary);
+     *          stevensMapLib::writeMapBinary(file, counts);
+     * 
+     * @param stream The binary stream we are writing to.
+     * @param map The maplike object we are writing. Its keys and values must be stringlike or trivially copyable.
+     */
+    template <typename M>
+    void writeMapBinary(    std::ostream & stream,
+                            const M & map   )
+    {
+        using K = std::remove_cvref_t<decltype(map.begin()->first)>;
+        using V = std::remove_cvref_t<decltype(map.begin()->second)>;
+        BinaryMapWriter<K,V> writer(stream, detail::isOrderedByLess<M>, map.size());
+        for(const auto & [key,value] : map)
+        {
+            writer.write(key, value);
+        }
+        writer.finish();
+    }
+
+
+    /**
+     * @brief Writes a ShardedMap to a binary stream one shard at a time. Like the other ShardedMap scans, the result is weakly
+     *        consistent; write snapshot() instead for a consistent copy.
+     */
+    template <typename K, typename V, typename Map, typename ShardHash>
+    void writeMapBinary(    std::ostream & stream,
+                            const ShardedMap<K,V,Map,ShardHash> & map   )
+    {
+        BinaryMapWriter<K,V> writer(stream);
+        map.forEachShard([&](const Map & shard)
+        {
+            for(const auto & [key,value] : shard)
+            {
+                writer.write(key, value);
+            }
+        });
+        writer.finish();
+    }
+
+
+    /**
+     * @brief Writes a ConcurrentHashMap to a binary stream without locking it.
+     */
+    template <typename K, typename V, typename Hash, typename KeyEqual>
+    void writeMapBinary(    std::ostream & stream,
+                            const ConcurrentHashMap<K,V,Hash,KeyEqual> & map    )
+    {
+        BinaryMapWriter<K,V> writer(stream);
+        map.forEach([&](const K & key, const V & value)
+        {
+            writer.write(key, value);
+        });
+        writer.finish();
+    }
+
+
+    /**
+     * @brief Loads every pair of a binary stream written by writeMapBinary() into map, replacing the values of keys map already
+     *        has. Hash maps are reserved to the stream's pair count before loading, and ordered maps insert each pair with a
+     *        hint at the end, which is constant time for sorted streams. Any map with insert_or_assign works, including
+     *        ShardedMap and ConcurrentHashMap.
+     * 
+     * @param stream The binary stream we are reading from.
+     * @param map The maplike object we are loading pairs into.
+     */
+    template <typename M>
+    void readMapBinary( std::istream & stream,
+                        M & map )
+    {
+        using K = typename M::key_type;
+        using V = typename M::mapped_type;
+        BinaryMapReader<K,V> reader(stream);
+        if constexpr(requires { map.reserve(reader.count()); })
+        {
+            if(reader.count() != reader.UnknownCount)
+            {
+                map.reserve(map.size() + reader.count());
+            }
+        }
+        K key{};
+        V value{};
+        while(reader.next(key, value))
+        {
+            detail::insertLoaded(map, std::move(key), std::move(value));
+        }
+    }
+
+
+    /**
+     * @brief Loads a binary stream written by writeMapBinary() into a new map of type M.
+     * 
+     * Example: std::ifstream file("counts.smlbin", std::ios::binary);
+     *          auto counts = stevensMapLib::readMapBinary< std::unordered_map<std::string,long> >(file);
+     */
+    template <typename M>
+    M readMapBinary(    std::istream & stream   )
+    {
+        M map;
+        stevensMapLib::readMapBinary(stream, map);
+        return map;
+    }
+
+
+    /*** External merges ***/
+    /**
+     * @brief Merges two or more sorted binary map files, which may be far larger than memory, into one sorted output file with
+     *        the semantics of addMaps(A, B, "values", omitKeysNotShared): values of keys found in more than one input are
+     *        summed. Inputs are streamed through large read buffers with a k-way merge, so memory use depends only on the number
+     *        of inputs, never on their sizes.
+     * 
+     * Each input must have been written sorted by std::less<K>, e.g. by writeMapBinary() from a std::map or by a BinaryMapWriter
+     * constructed with sorted set. Throws std::invalid_argument if an input is not flagged as sorted or turns out not to be, and
+     * std::runtime_error if a file can't be opened.
+     * 
+     * Example: stevensMapLib::mergeSortedMapFiles<std::string,long>({"monday.smlbin", "tuesday.smlbin"}, "week.smlbin");
+     * 
+     * @tparam K The type of keys in the files.
+     * @tparam V The numeric type of values in the files.
+     * @param inputPaths The sorted binary map files we are merging.
+     * @param outputPath The file the merged, sorted pairs are written to.
+     * @param omitKeysNotShared Whether to omit keys that are not found in every input.
+     * @return The number of pairs written to outputPath.
+     */
+    template <typename K, typename V>
+    std::uint64_t mergeSortedMapFiles(  const std::vector<std::string> & inputPaths,
+                                        const std::string & outputPath,
+                                        bool omitKeysNotShared = false  )
+    {
+        static constexpr std::size_t FileBufferSize = 1 << 20;
+
+        struct Input
+        {
+            std::vector<char> fileBuffer;
+            std::ifstream file;
+            std::optional< BinaryMapReader<K,V> > reader;
+            K key{};
+            V value{};
+        };
+
+        //Open every input; each keeps its next unmerged pair in key and value
+        std::vector< std::unique_ptr<Input> > inputs;
+        inputs.reserve(inputPaths.size());
+        for(const std::string & path : inputPaths)
+        {
+            auto input = std::make_unique<Input>();
+            input->fileBuffer.resize(FileBufferSize);
+            input->file.rdbuf()->pubsetbuf(input->fileBuffer.data(), static_cast<std::streamsize>(input->fileBuffer.size()));
+            input->file.open(path, std::ios::binary);
+            if(!input->file)
+            {
+                throw std::runtime_error("stevensMapLib::mergeSortedMapFiles() could not open " + path);
+            }
+            input->reader.emplace(input->file);
+            if(!input->reader->sorted())
+            {
+                throw std::invalid_argument("stevensMapLib::mergeSortedMapFiles() requires sorted input, but " + path + " is not sorted");
+            }
+            inputs.push_back(std::move(input));
+        }
+
+        std::vector<char> outputBuffer(FileBufferSize);
+        std::ofstream output;
+        output.rdbuf()->pubsetbuf(outputBuffer.data(), static_cast<std::streamsize>(outputBuffer.size()));
+        output.open(outputPath, std::ios::binary | std::ios::trunc);
+        if(!output)
+        {
+            throw std::runtime_error("stevensMapLib::mergeSortedMapFiles() could not open " + outputPath);
+        }
+        BinaryMapWriter<K,V> writer(output, true);
+
+        //A min-heap of the inputs that still have pairs, ordered by their next key
+        auto laterKey = [&](std::size_t a, std::size_t b)
+        {
+            return inputs[b]->key < inputs[a]->key;
+        };
+        std::vector<std::size_t> heap;
+        heap.reserve(inputs.size());
+        for(std::size_t i = 0; i < inputs.size(); i++)
+        {
+            if(inputs[i]->reader->next(inputs[i]->key, inputs[i]->value))
+            {
+                heap.push_back(i);
+            }
+        }
+        std::make_heap(heap.begin(), heap.end(), laterKey);
+
+        K key{};
+        while(!heap.empty())
+        {
+            //Sum the values of every input whose next key is the smallest key
+            std::pop_heap(heap.begin(), heap.end(), laterKey);
+            std::size_t first = heap.back();
+            key = inputs[first]->key;
+            V sum = inputs[first]->value;
+            std::size_t sharedBy = 1;
+            auto advance = [&](std::size_t i)
+            {
+                Input & input = *inputs[i];
+                if(input.reader->next(input.key, input.value))
+                {
+                    if(input.key < key || !(key < input.key))
+                    {
+                        throw std::invalid_argument("stevensMapLib::mergeSortedMapFiles() found an input whose keys are not sorted and unique: " + inputPaths[i]);
+                    }
+                    std::push_heap(heap.begin(), heap.end(), laterKey);
+                }
+                else
+                {
+                    heap.pop_back();
+                }
+            };
+            advance(first);
+            while(!heap.empty() && !(key < inputs[heap.front()]->key))
+            {
+                std::pop_heap(heap.begin(), heap.end(), laterKey);
+                std::size_t next = heap.back();
+                sum += inputs[next]->value;
+                sharedBy++;
+                advance(next);
+            }
+
+            if(!omitKeysNotShared || sharedBy == inputs.size())
+            {
+                writer.write(key, sum);
+            }
+        }
+
+        writer.finish();
+        return writer.written();
+    }
+
+
+    /*** Lazy map expressions ***/
+    namespace lazy
+    {
+        template <typename Node>
+        class MapExpression;
+    }
+
+    namespace detail
+    {
+        template <typename T>
+        constexpr bool isMapExpression = false;
+
+        template <typename Node>
+        constexpr bool isMapExpression< lazy::MapExpression<Node> > = true;
+
+        /**
+         * @brief Whether the value an expression node would give a key can be computed without visiting the whole node.
+         *        Nodes that rewrite keys can only be visited.
+         */
+        template <typename Node>
+        constexpr bool canLookUp = requires(const Node & node, const typename Node::key_type & key) { node.lookup(key); };
+
+        /**
+         * @brief The leaf of a lazy expression: a reference to a map, which must outlive the expression.
+         */
+        template <typename M>
+        struct LazyMapNode
+        {
+            using key_type = typename M::key_type;
+            using mapped_type = typename M::mapped_type;
+
+            template <typename F>
+            void forEach(   F && visitor    ) const
+            {
+                for(const auto & [key,value] : *map)
+                {
+                    visitor(key, value);
+                }
+            }
+
+            std::optional<mapped_type> lookup(  const key_type & key    ) const
+            {
+                auto it = map->find(key);
+                return it == map->end() ? std::nullopt : std::optional<mapped_type>(it->second);
+            }
+
+            const M * map;
+        };
+
+        /**
+         * @brief Sums two expressions with the semantics of addMaps(A, B, "values", omitKeysNotShared).
+         */
+        template <typename A, typename B>
+        requires canLookUp<A> && canLookUp<B>
+        struct LazyAddNode
+        {
+            using key_type = typename A::key_type;
+            using mapped_type = typename A::mapped_type;
+
+            template <typename F>
+            void forEach(   F && visitor    ) const
+            {
+                a.forEach([&](const key_type & key, const mapped_type & value)
+                {
+                    std::optional<mapped_type> match = b.lookup(key);
+                    if(match)
+                    {
+                        visitor(key, value + *match);
+                    }
+                    else if(!omitKeysNotShared)
+                    {
+                        visitor(key, value);
+                    }
+                });
+                if(!omitKeysNotShared)
+                {
+                    b.forEach([&](const key_type & key, const mapped_type & value)
+                    {
+                        if(!a.lookup(key))
+                        {
+                            visitor(key, value);
+                        }
+                    });
+                }
+            }
+
+            std::optional<mapped_type> lookup(  const key_type & key    ) const
+            {
+                std::optional<mapped_type> valueA = a.lookup(key);
+                std::optional<mapped_type> valueB = b.lookup(key);
+                if(valueA && valueB)
+                {
+                    return *valueA + *valueB;
+                }
+                return omitKeysNotShared ? std::nullopt : (valueA ? valueA : valueB);
+            }
+
+            A a;
+            B b;
+            bool omitKeysNotShared;
+        };
+
+        /**
+         * @brief Applies a function to every value of an expression, keeping its keys.
+         */
+        template <typename E, typename Transform>
+        struct LazyValueNode
+        {
+            using key_type = typename E::key_type;
+            using mapped_type = typename E::mapped_type;
+
+            template <typename F>
+            void forEach(   F && visitor    ) const
+            {
+                inner.forEach([&](const key_type & key, const mapped_type & value)
+                {
+                    visitor(key, transform(value));
+                });
+            }
+
+            std::optional<mapped_type> lookup(  const key_type & key    ) const
+                requires canLookUp<E>
+            {
+                std::optional<mapped_type> value = inner.lookup(key);
+                return value ? std::optional<mapped_type>(transform(*value)) : std::nullopt;
+            }
+
+            E inner;
+            Transform transform;
+        };
+
+        /**
+         * @brief Keeps only the pairs of an expression that satisfy a predicate taking (key, value).
+         */
+        template <typename E, typename Predicate>
+        struct LazyFilterNode
+        {
+            using key_type = typename E::key_type;
+            using mapped_type = typename E::mapped_type;
+
+            template <typename F>
+            void forEach(   F && visitor    ) const
+            {
+                inner.forEach([&](const key_type & key, const mapped_type & value)
+                {
+                    if(predicate(key, value))
+                    {
+                        visitor(key, value);
+                    }
+                });
+            }
+
+            std::optional<mapped_type> lookup(  const key_type & key    ) const
+                requires canLookUp<E>
+            {
+                std::optional<mapped_type> value = inner.lookup(key);
+                return value && predicate(key, *value) ? value : std::nullopt;
+            }
+
+            E inner;
+            Predicate predicate;
+        };
+
+        /**
+         * @brief Turns a map or an expression into an expression node. Maps are referenced, so they must be lvalues that
+         *        outlive the expression.
+         */
+        template <typename T>
+        auto toLazyNode(    T && operand    )
+        {
+            using Operand = std::remove_cvref_t<T>;
+            if constexpr(isMapExpression<Operand>)
+            {
+                return operand.node();
+            }
+            else
+            {
+                static_assert(std::is_lvalue_reference_v<T>, "stevensMapLib::lazy expressions reference their maps, so a map operand must not be a temporary");
+                return LazyMapNode<Operand>{ &operand };
+            }
+        }
+    }
+
+
+    /**
+     * @brief Lazy versions of the library's map transformations. Each function returns a MapExpression describing the result
+     *        instead of building it, and expressions compose, so a whole chain is evaluated in one fused pass over its source
+     *        maps with no intermediate containers. Reducing an expression with sumAllValues() or getPairWithMaxValue() allocates
+     *        nothing; evaluate() builds the result map once at the end.
+     * 
+     * Example: double total = stevensMapLib::sumAllValues(lazy::multiplyWithValues(lazy::addMaps(A, B, "values"), f));
+     * 
+     * Expressions hold references to their source maps, which must outlive them.
+     */
+    namespace lazy
+    {
+        /**
+         * @brief A lazily evaluated maplike result. Visiting it with forEach() computes each pair on the fly.
+         */
+        template <typename Node>
+        class MapExpression
+        {
+            public:
+                using key_type = typename Node::key_type;
+                using mapped_type = typename Node::mapped_type;
+
+                explicit MapExpression( Node node   ) : m_node(std::move(node)) {}
+
+                /**
+                 * @brief Calls visitor(key, value) for every pair of the result.
+                 */
+                template <typename F>
+                void forEach(   F && visitor    ) const
+                {
+                    m_node.forEach(visitor);
+                }
+
+                /**
+                 * @brief Computes the value the result would have for key, or std::nullopt if the result would not contain key.
+                 *        Not available for expressions that rewrite keys.
+                 */
+                std::optional<mapped_type> lookup(  const key_type & key    ) const
+                    requires detail::canLookUp<Node>
+                {
+                    return m_node.lookup(key);
+                }
+
+                const Node & node() const
+                {
+                    return m_node;
+                }
+
+            private:
+                Node m_node;
+        };
+
+
+        /**
+         * @brief Lazily adds the values of two maps or expressions, like stevensMapLib::addMaps(A, B, "values", omitKeysNotShared).
+         *        Only the "values" target is supported, since concatenated keys can't be looked up lazily; other targets throw
+         *        std::invalid_argument.
+         */
+        template <typename A, typename B>
+        auto addMaps(   A && mapA,
+                        B && mapB,
+                        const std::string & addOperationTarget = "values",
+                        bool omitKeysNotShared = false  )
+        {
+            if(addOperationTarget != "values")
+            {
+                throw std::invalid_argument("stevensMapLib::lazy::addMaps() only supports the \"values\" addOperationTarget");
+            }
+            using NodeA = decltype(detail::toLazyNode(std::forward<A>(mapA)));
+            using NodeB = decltype(detail::toLazyNode(std::forward<B>(mapB)));
+            return MapExpression< detail::LazyAddNode<NodeA,NodeB> >({ detail::toLazyNode(std::forward<A>(mapA)), detail::toLazyNode(std::forward<B>(mapB)), omitKeysNotShared });
+        }
+
+
+        /**
+         * @brief Lazily multiplies every value of a map or expression by factor, like stevensMapLib::multiplyWithValues().
+         */
+        template <typename E>
+        auto multiplyWithValues(    E && map,
+                                    long double factor  )
+        {
+            auto node = detail::toLazyNode(std::forward<E>(map));
+            using V = typename decltype(node)::mapped_type;
+            auto scale = [factor](const V & value) -> V { return value * factor; };
+            return MapExpression< detail::LazyValueNode<decltype(node), decltype(scale)> >({ std::move(node), scale });
+        }
+
+
+        /**
+         * @brief Lazily replaces every negative value of a map or expression with zero, like stevensMapLib::setNegativeValuesToZero().
+         */
+        template <typename E>
+        auto setNegativeValuesToZero(   E && map    )
+        {
+            auto node = detail::toLazyNode(std::forward<E>(map));
+            using V = typename decltype(node)::mapped_type;
+            auto clamp = [](const V & value) -> V { return value < 0 ? V(0) : value; };
+            return MapExpression< detail::LazyValueNode<decltype(node), decltype(clamp)> >({ std::move(node), clamp });
+        }
+
+
+        /**
+         * @brief Lazily keeps only the pairs of a map or expression for which predicate(key, value) is true.
+         */
+        template <typename E, typename Predicate>
+        auto filter(    E && map,
+                        Predicate predicate )
+        {
+            auto node = detail::toLazyNode(std::forward<E>(map));
+            return MapExpression< detail::LazyFilterNode<decltype(node), Predicate> >({ std::move(node), std::move(predicate) });
+        }
+
+
+        /**
+         * @brief Lazily keeps only the pairs of a map or expression whose stringlike keys start with str, like
+         *        stevensMapLib::getPairsWhereKeysStartWith().
+         */
+        template <typename E>
+        auto getPairsWhereKeysStartWith(    E && map,
+                                            std::string_view str    )
+        {
+            return lazy::filter(std::forward<E>(map), [prefix = std::string(str)](const auto & key, const auto &)
+            {
+                return stevensMapLib::detail::keyView(key).starts_with(prefix);
+            });
+        }
+
+
+        /**
+         * @brief Evaluates an expression into a map of type M<K,V> in one pass.
+         * 
+         * Example: auto result = lazy::evaluate<std::map>(lazy::setNegativeValuesToZero(lazy::addMaps(A, B, "values")));
+         */
+        template <template <typename, typename, typename...> class M = std::unordered_map, typename Node>
+        M<typename Node::key_type, typename Node::mapped_type> evaluate(    const MapExpression<Node> & expression  )
+        {
+            M<typename Node::key_type, typename Node::mapped_type> result = {};
+            expression.forEach([&](const auto & key, const auto & value)
+            {
+                result.emplace(key, value);
+            });
+            return result;
+        }
+    }
+
+
+    /**
+     * @brief Sums the values of a lazy map expression in one fused pass, without allocating.
+     * 
+     * @param expression The expression whose values we want to sum together.
+     * @param initialValue The value we begin our sum from.
+     * @return The sum of all values the expression produces, added to the initial value.
+     */
+    template <typename Node>
+    typename Node::mapped_type sumAllValues(    const lazy::MapExpression<Node> & expression,
+                                                typename Node::mapped_type initialValue = 0 )
+    {
+        typename Node::mapped_type sum = initialValue;
+        expression.forEach([&](const auto &, const auto & value)
+        {
+            sum += value;
+        });
+        return sum;
+    }
+
+
+    /**
+     * @brief Returns the pair a lazy map expression produces with the greatest value, in one fused pass. If more than one pair
+     *        has the greatest value, the first one produced is returned.
+     */
+    template <typename Node>
+    std::pair<typename Node::key_type, typename Node::mapped_type> getPairWithMaxValue( const lazy::MapExpression<Node> & expression   )
+    {
+        std::optional< std::pair<typename Node::key_type, typename Node::mapped_type> > maxPair;
+        expression.forEach([&](const auto & key, const auto & value)
+        {
+            if(!maxPair || value > maxPair->second)
+            {
+                maxPair.emplace(key, value);
+            }
+        });
+        if(!maxPair)
+        {
+            throw std::invalid_argument("stevensMapLib::getPairWithMaxValue() cannot get a pair from an empty map");
+        }
+        return *maxPair;
+    }
+
+
+    /*** Map pipelines ***/
+    namespace detail
+    {
+        /**
+         * @brief Rewrites the keys of an expression with a function of the key, keeping its values. The rewritten keys can't be
+         *        mapped back, so a key-rewriting expression has no lookup() and can only be visited, which makes combining it
+         *        with another expression, e.g. in lazy::addMaps(), a compile error.
+         */
+        template <typename E, typename KeyTransform>
+        struct LazyKeyNode
+        {
+            using key_type = typename E::key_type;
+            using mapped_type = typename E::mapped_type;
+
+            template <typename F>
+            void forEach(   F && visitor    ) const
+            {
+                inner.forEach([&](const key_type & key, const mapped_type & value)
+                {
+                    visitor(transform(key), value);
+                });
+            }
+
+            E inner;
+            KeyTransform transform;
+        };
+
+        /**
+         * @brief A pipeline stage waiting for the map or expression on the left of the |.
+         */
+        template <typename Stage>
+        struct PipelineAdaptor
+        {
+            Stage stage;
+        };
+
+        /**
+         * @brief The final stage of a pipeline, which materializes its result.
+         */
+        template <typename Terminal>
+        struct PipelineTerminal
+        {
+            Terminal terminal;
+        };
+    }
+
+
+    /**
+     * @brief Range adaptors over maps, written with |, that build on the lazy map expressions so that a whole pipeline runs as
+     *        a single pass over its source when a terminal operation (collect() or sum()) is reached.
+     * 
+     * Example: auto styles = map | keysStartingWith("style:") | stripFromKeys("style:") | scaleValues(2.0) | collect<std::unordered_map>();
+     * 
+     * The source map must outlive the pipeline, and should be an lvalue.
+     */
+    namespace pipeline
+    {
+        /**
+         * @brief Keeps only the pairs whose stringlike keys start with str, like getPairsWhereKeysStartWith().
+         */
+        inline auto keysStartingWith(   std::string_view str    )
+        {
+            auto stage = [prefix = std::string(str)](auto && source)
+            {
+                return lazy::getPairsWhereKeysStartWith(std::forward<decltype(source)>(source), prefix);
+            };
+            return detail::PipelineAdaptor<decltype(stage)>{ std::move(stage) };
+        }
+
+        /**
+         * @brief Erases every instance of str from the stringlike keys, like eraseStringFromKeys().
+         */
+        inline auto stripFromKeys(  std::string_view str    )
+        {
+            auto stage = [target = std::string(str)](auto && source)
+            {
+                auto node = detail::toLazyNode(std::forward<decltype(source)>(source));
+                using K = typename decltype(node)::key_type;
+                auto strip = [target](const K & key) -> K
+                {
+                    return detail::stripKey(key, target);
+                };
+                return lazy::MapExpression< detail::LazyKeyNode<decltype(node), decltype(strip)> >({ std::move(node), strip });
+            };
+            return detail::PipelineAdaptor<decltype(stage)>{ std::move(stage) };
+        }
+
+        /**
+         * @brief Multiplies every value by factor, like multiplyWithValues().
+         */
+        inline auto scaleValues(    long double factor  )
+        {
+            auto stage = [factor](auto && source)
+            {
+                return lazy::multiplyWithValues(std::forward<decltype(source)>(source), factor);
+            };
+            return detail::PipelineAdaptor<decltype(stage)>{ std::move(stage) };
+        }
+
+        /**
+         * @brief Replaces every negative value with zero, like setNegativeValuesToZero().
+         */
+        inline auto clampNegativesToZero()
+        {
+            auto stage = [](auto && source)
+            {
+                return lazy::setNegativeValuesToZero(std::forward<decltype(source)>(source));
+            };
+            return detail::PipelineAdaptor<decltype(stage)>{ std::move(stage) };
+        }
+
+        /**
+         * @brief Keeps only the pairs for which predicate(key, value) is true.
+         */
+        template <typename Predicate>
+        auto filter(    Predicate predicate )
+        {
+            auto stage = [predicate = std::move(predicate)](auto && source)
+            {
+                return lazy::filter(std::forward<decltype(source)>(source), predicate);
+            };
+            return detail::PipelineAdaptor<decltype(stage)>{ std::move(stage) };
+        }
+
+        /**
+         * @brief Ends a pipeline by building its result as an M<K,V>, in the single pass that runs every stage.
+         */
+        template <template <typename, typename, typename...> class M = std::unordered_map>
+        auto collect()
+        {
+            auto terminal = [](const auto & expression)
+            {
+                return lazy::evaluate<M>(expression);
+            };
+            return detail::PipelineTerminal<decltype(terminal)>{ terminal };
+        }
+
+        /**
+         * @brief Ends a pipeline by summing its values, like sumAllValues(), without allocating.
+         */
+        inline auto sum()
+        {
+            auto terminal = [](const auto & expression)
+            {
+                return stevensMapLib::sumAllValues(expression);
+            };
+            return detail::PipelineTerminal<decltype(terminal)>{ terminal };
+        }
+    }
+
+
+    namespace detail
+    {
+        /**
+         * @brief Whether T can stand on the left of a pipeline |: a maplike object or a lazy expression.
+         */
+        template <typename T>
+        concept PipelineSource = isMapExpression<std::remove_cvref_t<T>> || requires(const std::remove_cvref_t<T> & map)
+        {
+            typename std::remove_cvref_t<T>::key_type;
+            typename std::remove_cvref_t<T>::mapped_type;
+            map.begin();
+            map.find(std::declval<typename std::remove_cvref_t<T>::key_type>());
+        };
+
+        template <PipelineSource Source, typename Stage>
+        auto operator|( Source && source,
+                        const PipelineAdaptor<Stage> & adaptor  )
+        {
+            return adaptor.stage(std::forward<Source>(source));
+        }
+
+        template <PipelineSource Source, typename Terminal>
+        auto operator|( Source && source,
+                        const PipelineTerminal<Terminal> & terminal )
+        {
+            if constexpr(isMapExpression<std::remove_cvref_t<Source>>)
+            {
+                return terminal.terminal(source);
+            }
+            else
+            {
+                auto node = toLazyNode(std::forward<Source>(source));
+                return terminal.terminal(lazy::MapExpression<decltype(node)>(node));
+            }
+        }
+    }
+
+
+    /*** Hash table diagnostics ***/
+    /**
+     * @brief A report on how evenly a hash map spreads its keys over its buckets, produced by diagnoseHashTable().
+     */
+    struct HashTableDiagnostics
+    {
+        std::size_t size = 0;
+        std::size_t bucketCount = 0;
+        float loadFactor = 0;
+        float maxLoadFactor = 0;
+        //occupancyHistogram[c] is the number of buckets holding exactly c keys
+        std::vector<std::size_t> occupancyHistogram;
+        std::size_t longestChain = 0;
+        //The average number of keys compared by a lookup that finds its key, and by one that doesn't
+        double expectedProbesHit = 0;
+        double expectedProbesMiss = 0;
+        //expectedProbesHit for the same size and bucket count if the hasher spread keys uniformly at random
+        double uniformProbesHit = 0;
+        //The number of distinct full hash values among the keys sampled, before they're reduced to bucket indices
+        std::size_t sampledKeys = 0;
+        std::size_t distinctSampledHashes = 0;
+
+        /**
+         * @brief Whether lookups cost more than tolerance times what a uniform hasher would give, or whether distinct keys
+         *        share full hash values, either of which means the hasher is a poor fit for the keys.
+         */
+        bool hasDegenerateHasher(   double tolerance = 2.0  ) const noexcept
+        {
+            bool chainsTooLong = size > 0 && expectedProbesHit > tolerance * uniformProbesHit;
+            //A 64-bit hash should practically never repeat across distinct keys, so allow only a sliver of collisions
+            bool hashesCollide = distinctSampledHashes + sampledKeys / 100 < sampledKeys;
+            return chainsTooLong || hashesCollide;
+        }
+    };
+
+
+    /**
+     * @brief Walks an unordered map's bucket interface and reports its load factor, how many keys each bucket holds, and how
+     *        many key comparisons its lookups are expected to make. Use it when lookups in functions like addMaps or
+     *        createUniqueKeyString are slower than expected, to tell a bad hasher from a high load factor.
+     * 
+     * Example: auto diagnostics = stevensMapLib::diagnoseHashTable(map);
+     *          if(diagnostics.hasDegenerateHasher()) { ... }
+     * 
+     * @tparam M The type of the unordered maplike object, which must provide bucket_count(), bucket_size() and hash_function().
+     * @param map The map to diagnose.
+     * @param hashSampleSize How many keys, from the start of the map, have their full hash values checked for repeats.
+     * @return The map's HashTableDiagnostics.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    requires requires(const M<K,V,Args...> & map) { map.bucket_count(); map.bucket_size(0); map.hash_function(); }
+    HashTableDiagnostics diagnoseHashTable( const M<K,V,Args...> & map,
+                                            std::size_t hashSampleSize = 4096   )
+    {
+        HashTableDiagnostics diagnostics;
+        diagnostics.size = map.size();
+        diagnostics.bucketCount = map.bucket_count();
+        diagnostics.loadFactor = map.load_factor();
+        diagnostics.maxLoadFactor = map.max_load_factor();
+
+        //A key at position i of a chain takes i comparisons to find, so a chain of c keys costs c(c+1)/2 over its keys
+        double hitProbes = 0;
+        for(std::size_t bucket = 0; bucket < diagnostics.bucketCount; bucket++)
+        {
+            std::size_t chain = map.bucket_size(bucket);
+            if(chain >= diagnostics.occupancyHistogram.size())
+            {
+                diagnostics.occupancyHistogram.resize(chain + 1);
+            }
+            diagnostics.occupancyHistogram[chain]++;
+            diagnostics.longestChain = std::max(diagnostics.longestChain, chain);
+            hitProbes += double(chain) * double(chain + 1) / 2;
+        }
+        if(diagnostics.size > 0)
+        {
+            diagnostics.expectedProbesHit = hitProbes / double(diagnostics.size);
+            diagnostics.uniformProbesHit = 1 + double(diagnostics.size - 1) / (2 * double(diagnostics.bucketCount));
+        }
+        //A missed lookup lands in a bucket chosen by its hash and compares against the whole chain
+        if(diagnostics.bucketCount > 0)
+        {
+            diagnostics.expectedProbesMiss = double(diagnostics.size) / double(diagnostics.bucketCount);
+        }
+
+        std::vector<std::size_t> hashes;
+        hashes.reserve(std::min(hashSampleSize, diagnostics.size));
+        auto hasher = map.hash_function();
+        for(auto it = map.begin(); it != map.end() && hashes.size() < hashSampleSize; it++)
+        {
+            hashes.push_back(hasher(it->first));
+        }
+        std::sort(hashes.begin(), hashes.end());
+        diagnostics.sampledKeys = hashes.size();
+        diagnostics.distinctSampledHashes = std::unique(hashes.begin(), hashes.end()) - hashes.begin();
+
+        return diagnostics;
+    }
+
+
+    /**
+     * @brief A quick check of whether map's hasher is a poor fit for its keys: lookups cost more than tolerance times what a
+     *        uniform hasher would give, or distinct keys share full hash values.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    requires requires(const M<K,V,Args...> & map) { map.bucket_count(); map.bucket_size(0); map.hash_function(); }
+    bool hasDegenerateHasher(   const M<K,V,Args...> & map,
+                                double tolerance = 2.0  )
+    {
+        return stevensMapLib::diagnoseHashTable(map, 1024).hasDegenerateHasher(tolerance);
+    }
+
+
+    /*** Chunked scans ***/
+    /**
+     * @brief A scan that runs a bounded chunk of entries each time the caller resumes it, so long scans can share a thread
+     *        with an event loop. Nothing runs until the first resume(), and the map being scanned must outlive the task and
+     *        not be modified until the task is done.
+     * 
+     * Example: auto task = stevensMapLib::sumAllValuesChunked(map, 100000);
+     *          while(task.resume())
+     *          {
+     *              eventLoop.runPending();
+     *          }
+     *          int sum = task.result();
+     * 
+     * @tparam T The type of the scan's result.
+     */
+    template <typename T>
+    class ChunkedTask
+    {
+        public:
+            struct promise_type
+            {
+                std::optional<T> m_result;
+                std::exception_ptr m_exception;
+                std::size_t m_processed = 0;
+
+                ChunkedTask get_return_object() noexcept { return ChunkedTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+                std::suspend_always initial_suspend() noexcept { return {}; }
+                std::suspend_always final_suspend() noexcept { return {}; }
+                std::suspend_always yield_value(    std::size_t processed   ) noexcept
+                {
+                    m_processed = processed;
+                    return {};
+                }
+                void return_value(  T value )
+                {
+                    m_result.emplace(std::move(value));
+                }
+                void unhandled_exception() noexcept { m_exception = std::current_exception(); }
+            };
+
+            ChunkedTask(    ChunkedTask && other    ) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+
+            ChunkedTask & operator=(    ChunkedTask && other    ) noexcept
+            {
+                if(this != &other)
+                {
+                    if(m_handle)
+                    {
+                        m_handle.destroy();
+                    }
+                    m_handle = std::exchange(other.m_handle, nullptr);
+                }
+                return *this;
+            }
+
+            ~ChunkedTask()
+            {
+                if(m_handle)
+                {
+                    m_handle.destroy();
+                }
+            }
+
+            /**
+             * @brief Processes the next chunk of entries.
+             * 
+             * @return Whether there are entries left to process, i.e. whether the task needs to be resumed again.
+             * 
+             * @throws std::logic_error if the task has been moved from.
+             */
+            bool resume()
+            {
+                requireHandle("resume");
+                if(!m_handle.done())
+                {
+                    m_handle.resume();
+                }
+                return !m_handle.done();
+            }
+
+            /**
+             * @brief Whether the scan has finished. A task that has been moved from has nothing left to run, so it counts as done.
+             */
+            bool done() const noexcept { return !m_handle || m_handle.done(); }
+
+            /**
+             * @brief The number of entries processed so far, or 0 if the task has been moved from.
+             */
+            std::size_t processed() const noexcept { return m_handle ? m_handle.promise().m_processed : 0; }
+
+            /**
+             * @brief The result of the scan, once done() is true.
+             * 
+             * @throws std::logic_error if the scan hasn't finished or the task has been moved from, or whatever the scan threw.
+             */
+            T & result()
+            {
+                requireHandle("result");
+                if(!m_handle.done())
+                {
+                    throw std::logic_error("stevensMapLib::ChunkedTask::result() the scan hasn't finished yet");
+                }
+                if(m_handle.promise().m_exception)
+                {
+                    std::rethrow_exception(m_handle.promise().m_exception);
+                }
+                return *m_handle.promise().m_result;
+            }
+
+            /**
+             * @brief Processes every remaining chunk without yielding and returns the result, like the blocking version would.
+             */
+            T & run()
+            {
+                while(resume()) {}
+                return result();
+            }
+
+        private:
+            explicit ChunkedTask(   std::coroutine_handle<promise_type> handle  ) noexcept : m_handle(handle) {}
+
+            void requireHandle( const char * function   ) const
+            {
+                if(!m_handle)
+                {
+                    throw std::logic_error(std::string("stevensMapLib::ChunkedTask::") + function + "() the task has been moved from");
+                }
+            }
+
+            std::coroutine_handle<promise_type> m_handle;
+    };
+
+
+    namespace detail
+    {
+        template <typename Map, typename V>
+        ChunkedTask<V> sumAllValuesChunked( const Map & map,
+                                            std::size_t chunkSize,
+                                            V sum   )
+        {
+            std::size_t processed = 0;
+            for(const auto & [key,value] : map)
+            {
+                sum += value;
+                if(++processed % chunkSize == 0)
+                {
+                    co_yield processed;
+                }
+            }
+            co_return sum;
+        }
+
+        template <typename Map, typename K>
+        ChunkedTask<std::vector<K>> getKeyVectorChunked(    const Map & map,
+                                                            std::size_t chunkSize   )
+        {
+            std::vector<K> keyVector;
+            keyVector.reserve(map.size());
+            for(const auto & [key,value] : map)
+            {
+                keyVector.push_back(key);
+                if(keyVector.size() % chunkSize == 0)
+                {
+                    co_yield keyVector.size();
+                }
+            }
+            co_return std::move(keyVector);
+        }
+
+        template <typename Map>
+        ChunkedTask<Map> eraseStringFromKeysChunked(    const Map & map,
+                                                        std::string target,
+                                                        std::size_t chunkSize   )
+        {
+            Map returnMap = detail::emptyLike(map, map.get_allocator());
+            std::size_t processed = 0;
+            for(const auto & [key,value] : map)
+            {
+                returnMap.emplace(detail::stripKey(key, target), value);
+                if(++processed % chunkSize == 0)
+                {
+                    co_yield processed;
+                }
+            }
+            co_return std::move(returnMap);
+        }
+
+        inline void checkChunkSize( std::size_t chunkSize,
+                                    const char * functionName   )
+        {
+            if(chunkSize == 0)
+            {
+                throw std::invalid_argument(std::string("stevensMapLib::") + functionName + "() needs a chunk size of at least one entry");
+            }
+        }
+    }
+
+
+    /**
+     * @brief The same as sumAllValues(map, initialValue), but as a ChunkedTask that adds up chunkSize values each time it's
+     *        resumed.
+     * 
+     * @param map The map containing numeric values that we want to sum together, which must outlive the task.
+     * @param chunkSize The most values to add before yielding back to the caller.
+     * @param initialValue The value we begin our sum from.
+     * @return A ChunkedTask whose result is the sum of all values in the map added to the initial value.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    ChunkedTask<V> sumAllValuesChunked( const M<K,V,Args...> & map,
+                                        std::size_t chunkSize,
+                                        V initialValue = 0  )
+    {
+        detail::checkChunkSize(chunkSize, "sumAllValuesChunked");
+        return detail::sumAllValuesChunked(map, chunkSize, initialValue);
+    }
+
+
+    /**
+     * @brief The same as getKeyVector(map), but as a ChunkedTask that collects chunkSize keys each time it's resumed.
+     * 
+     * @param map The maplike object we are obtaining keys from, which must outlive the task.
+     * @param chunkSize The most keys to collect before yielding back to the caller.
+     * @return A ChunkedTask whose result is a vector containing all of the keys found in order from the maplike object.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    ChunkedTask<std::vector<K>> getKeyVectorChunked(    const M<K,V,Args...> & map,
+                                                        std::size_t chunkSize   )
+    {
+        detail::checkChunkSize(chunkSize, "getKeyVectorChunked");
+        return detail::getKeyVectorChunked<M<K,V,Args...>, K>(map, chunkSize);
+    }
+
+
+    /**
+     * @brief The same as eraseStringFromKeys(map, str), but as a ChunkedTask that rewrites chunkSize keys each time it's resumed.
+     * 
+     * @param map The maplike object with stringlike keys we are modifying the keys of, which must outlive the task.
+     * @param str The string we wish to erase from all of map's keys. It's copied into the task, so it can be a temporary.
+     * @param chunkSize The most keys to rewrite before yielding back to the caller.
+     * @return A ChunkedTask whose result is a copy of map, using the same allocator, with str erased from all of its keys.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    ChunkedTask<M<K,V,Args...>> eraseStringFromKeysChunked( const M<K,V,Args...> & map,
+                                                            std::string_view str,
+                                                            std::size_t chunkSize   )
+    {
+        detail::checkChunkSize(chunkSize, "eraseStringFromKeysChunked");
+        return detail::eraseStringFromKeysChunked(map, std::string(str), chunkSize);
+    }
+
+
+    /*** Thread pool and parallel algorithms ***/
+    /**
+     * @brief A reusable pool of worker threads that the library's parallel overloads run on, so they don't pay for starting
+     *        threads on every call. Each worker has its own task deque: it runs its newest task first, and when its deque is
+     *        empty it steals the oldest task of another worker.
+     * 
+     * Example: stevensMapLib::ThreadPool pool(8);
+     *          int sum = stevensMapLib::sumAllValues(stevensMapLib::ParallelPolicy{&pool}, map);
+     */
+    class ThreadPool
+    {
+        public:
+            /**
+             * @param threadCount The number of worker threads. The thread calling parallelFor() works alongside them, so the
+             *                    default leaves one hardware thread for it.
+             */
+            explicit ThreadPool(    std::size_t threadCount = std::max(1u, std::thread::hardware_concurrency()) - 1    )
+                : m_workerCount(threadCount), m_queues(std::make_unique<WorkerQueue[]>(std::max<std::size_t>(threadCount, 1)))
+            {
+                m_threads.reserve(threadCount);
+                for(std::size_t i = 0; i < threadCount; i++)
+                {
+                    m_threads.emplace_back([this, i] { workerLoop(i); });
+                }
+            }
+
+            ThreadPool( const ThreadPool &  ) = delete;
+            ThreadPool & operator=( const ThreadPool &  ) = delete;
+
+            /**
+             * @brief Runs every task already submitted, then stops and joins the workers.
+             */
+            ~ThreadPool()
+            {
+                {
+                    std::scoped_lock lock(m_sleepMutex);
+                    m_stopping = true;
+                }
+                m_wake.notify_all();
+                for(std::thread & thread : m_threads)
+                {
+                    thread.join();
+                }
+            }
+
+            std::size_t threadCount() const noexcept
+            {
+                return m_workerCount;
+            }
+
+            /**
+             * @brief Queues task to run on a worker. Tasks submitted from a worker go on that worker's own deque.
+             */
+            void submit(    std::function<void()> task  )
+            {
+                if(m_workerCount == 0)
+                {
+                    task();
+                    return;
+                }
+                std::size_t queue = t_pool == this ? t_workerIndex : m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_workerCount;
+                {
+                    std::scoped_lock lock(m_sleepMutex);
+                    m_queued++;
+                }
+                {
+                    std::scoped_lock lock(m_queues[queue].mutex);
+                    m_queues[queue].tasks.push_back(std::move(task));
+                }
+                m_wake.notify_one();
+            }
+
+            /**
+             * @brief Calls body(chunkBegin, chunkEnd) over [begin, end) split into chunks of grain indices, on the workers and
+             *        the calling thread, and returns once every chunk is done. Safe to call from inside a task, since the
+             *        caller runs chunks itself rather than only waiting for workers.
+             * 
+             * @throws The first exception thrown by body, after every chunk has finished.
+             */
+            template <typename Body>
+            void parallelFor(   std::size_t begin,
+                                std::size_t end,
+                                std::size_t grain,
+                                Body && body    )
+            {
+                if(begin >= end)
+                {
+                    return;
+                }
+                grain = std::max<std::size_t>(grain, 1);
+                std::size_t chunks = (end - begin - 1) / grain + 1;
+                if(chunks == 1 || m_workerCount == 0)
+                {
+                    body(begin, end);
+                    return;
+                }
+
+                //Chunks are handed out by a shared counter rather than queued one by one, so a helper that starts late just
+                //finds nothing left to do. The state is shared because such a helper may outlive this call.
+                struct State
+                {
+                    std::atomic<std::size_t> next = 0;
+                    std::atomic<std::size_t> finished = 0;
+                    std::mutex mutex;
+                    std::condition_variable allFinished;
+                    std::exception_ptr exception;
+                };
+                auto state = std::make_shared<State>();
+                auto runChunks = [state, begin, end, grain, chunks, &body]()
+                {
+                    for(std::size_t chunk; (chunk = state->next.fetch_add(1, std::memory_order_relaxed)) < chunks; )
+                    {
+                        std::size_t chunkBegin = begin + chunk * grain;
+                        try
+                        {
+                            body(chunkBegin, std::min(end, chunkBegin + grain));
+                        }
+                        catch(...)
+                        {
+                            std::scoped_lock lock(state->mutex);
+                            if(!state->exception)
+                            {
+                                state->exception = std::current_exception();
+                            }
+                        }
+                        if(state->finished.fetch_add(1, std::memory_order_acq_rel) + 1 == chunks)
+                        {
+                            std::scoped_lock lock(state->mutex);
+                            state->allFinished.notify_all();
+                        }
+                    }
+                };
+
+                for(std::size_t helper = 0; helper < std::min(chunks - 1, m_workerCount); helper++)
+                {
+                    submit(runChunks);
+                }
+                runChunks();
+
+                std::unique_lock lock(state->mutex);
+                state->allFinished.wait(lock, [&state, chunks] { return state->finished.load(std::memory_order_acquire) == chunks; });
+                if(state->exception)
+                {
+                    std::rethrow_exception(state->exception);
+                }
+            }
+
+            /**
+             * @brief The pool used by parallel overloads that aren't given one, created on first use.
+             */
+            static ThreadPool & global()
+            {
+                static ThreadPool pool;
+                return pool;
+            }
+
+        private:
+            struct alignas(64) WorkerQueue
+            {
+                std::mutex mutex;
+                std::deque< std::function<void()> > tasks;
+            };
+
+            bool tryRunTask(    std::size_t home    )
+            {
+                std::function<void()> task;
+                //Take our own newest task, which is most likely still in cache, or else steal another worker's oldest
+                for(std::size_t offset = 0; offset < m_workerCount && !task; offset++)
+                {
+                    WorkerQueue & queue = m_queues[(home + offset) % m_workerCount];
+                    std::scoped_lock lock(queue.mutex);
+                    if(!queue.tasks.empty())
+                    {
+                        if(offset == 0)
+                        {
+                            task = std::move(queue.tasks.back());
+                            queue.tasks.pop_back();
+                        }
+                        else
+                        {
+                            task = std::move(queue.tasks.front());
+                            queue.tasks.pop_front();
+                        }
+                    }
+                }
+                if(!task)
+                {
+                    return false;
+                }
+                {
+                    std::scoped_lock lock(m_sleepMutex);
+                    m_queued--;
+                }
+                task();
+                return true;
+            }
+
+            void workerLoop(    std::size_t index   )
+            {
+                t_pool = this;
+                t_workerIndex = index;
+                while(true)
+                {
+                    if(tryRunTask(index))
+                    {
+                        continue;
+                    }
+                    std::unique_lock lock(m_sleepMutex);
+                    m_wake.wait(lock, [this] { return m_stopping || m_queued > 0; });
+                    if(m_stopping && m_queued == 0)
+                    {
+                        return;
+                    }
+                }
+            }
+
+            //Fixed before any worker starts, since workers read it while the constructor is still starting the others
+            const std::size_t m_workerCount;
+            std::unique_ptr<WorkerQueue[]> m_queues;
+            std::vector<std::thread> m_threads;
+            std::atomic<std::size_t> m_nextQueue = 0;
+            std::mutex m_sleepMutex;
+            std::condition_variable m_wake;
+            std::size_t m_queued = 0;
+            bool m_stopping = false;
+
+            static inline thread_local ThreadPool * t_pool = nullptr;
+            static inline thread_local std::size_t t_workerIndex = 0;
+    };
+
+
+    /**
+     * @brief Selects the parallel overload of a library function, and says which pool it runs on and how finely it splits the
+     *        map. The grain adapts to the map: it's the map's size spread over tasksPerThread tasks per thread, but never
+     *        less than minGrain entries, so maps smaller than minGrain are processed on the calling thread alone.
+     * 
+     * Example: double total = stevensMapLib::sumAllValues(stevensMapLib::parallel, map);
+     */
+    struct ParallelPolicy
+    {
+        //The pool to run on, or nullptr for ThreadPool::global()
+        ThreadPool * pool = nullptr;
+        std::size_t minGrain = 16384;
+        std::size_t tasksPerThread = 4;
+
+        ThreadPool & threadPool() const
+        {
+            return pool ? *pool : ThreadPool::global();
+        }
+
+        /**
+         * @brief The number of entries each task should process, for a map of size entries.
+         */
+        std::size_t grainFor(   std::size_t size    ) const
+        {
+            if(threadPool().threadCount() == 0)
+            {
+                return std::max<std::size_t>(size, 1);
+            }
+            std::size_t tasks = (threadPool().threadCount() + 1) * std::max<std::size_t>(tasksPerThread, 1);
+            return std::max(std::max<std::size_t>(minGrain, 1), (size + tasks - 1) / tasks);
+        }
+    };
+
+    inline constexpr ParallelPolicy parallel = {};
+
+
+    namespace detail
+    {
+        /**
+         * @brief Splits a map into chunks of about grain entries that can be visited independently. Hash maps are split by
+         *        bucket, maps with random access iterators by position, and other maps by iterators found in one walk.
+         */
+        template <typename Map>
+        class EntryPartition
+        {
+            public:
+                EntryPartition( Map & map,
+                                std::size_t grain   ) : m_map(&map)
+                {
+                    //A map that fits in one chunk is walked with its own iterators, which is faster than walking its buckets
+                    if(grain >= map.size())
+                    {
+                        m_chunkCount = map.empty() ? 0 : 1;
+                        m_whole = true;
+                    }
+                    else if constexpr(hasBuckets)
+                    {
+                        //Spread grain entries' worth of buckets over each chunk
+                        m_units = map.bucket_count();
+                        m_unitsPerChunk = std::max<std::size_t>(1, grain * m_units / std::max<std::size_t>(map.size(), 1));
+                        m_chunkCount = map.empty() ? 0 : (m_units - 1) / m_unitsPerChunk + 1;
+                    }
+                    else if constexpr(hasRandomAccess)
+                    {
+                        m_units = map.size();
+                        m_unitsPerChunk = grain;
+                        m_chunkCount = m_units == 0 ? 0 : (m_units - 1) / m_unitsPerChunk + 1;
+                    }
+                    else
+                    {
+                        std::size_t position = 0;
+                        for(auto it = map.begin(); it != map.end(); it++, position++)
+                        {
+                            if(position % grain == 0)
+                            {
+                                m_boundaries.push_back(it);
+                            }
+                        }
+                        m_chunkCount = m_boundaries.size();
+                        m_boundaries.push_back(map.end());
+                    }
+                }
+
+                std::size_t chunkCount() const noexcept
+                {
+                    return m_chunkCount;
+                }
+
+                /**
+                 * @brief Calls visitor on every entry of chunk.
+                 */
+                template <typename Visitor>
+                void visit( std::size_t chunk,
+                            Visitor && visitor  ) const
+                {
+                    if(m_whole)
+                    {
+                        for(auto & entry : *m_map)
+                        {
+                            visitor(entry);
+                        }
+                    }
+                    else if constexpr(hasBuckets)
+                    {
+                        std::size_t lastBucket = std::min(m_units, (chunk + 1) * m_unitsPerChunk);
+                        for(std::size_t bucket = chunk * m_unitsPerChunk; bucket < lastBucket; bucket++)
+                        {
+                            for(auto it = m_map->begin(bucket); it != m_map->end(bucket); it++)
+                            {
+                                visitor(*it);
+                            }
+                        }
+                    }
+                    else if constexpr(hasRandomAccess)
+                    {
+                        auto it = m_map->begin() + chunk * m_unitsPerChunk;
+                        auto last = m_map->begin() + std::min(m_units, (chunk + 1) * m_unitsPerChunk);
+                        for(; it != last; it++)
+                        {
+                            visitor(*it);
+                        }
+                    }
+                    else
+                    {
+                        for(auto it = m_boundaries[chunk]; it != m_boundaries[chunk + 1]; it++)
+                        {
+                            visitor(*it);
+                        }
+                    }
+                }
+
+            private:
+                static constexpr bool hasBuckets = requires(Map & map) { map.bucket_count(); map.begin(std::size_t(0)); map.end(std::size_t(0)); };
+                static constexpr bool hasRandomAccess = std::random_access_iterator<decltype(std::declval<Map &>().begin())>;
+
+                Map * m_map;
+                std::size_t m_units = 0;
+                std::size_t m_unitsPerChunk = 1;
+                std::size_t m_chunkCount = 0;
+                bool m_whole = false;
+                std::vector<decltype(std::declval<Map &>().begin())> m_boundaries;
+        };
+
+
+        /**
+         * @brief Calls visitor on every entry of map, in parallel chunks chosen by policy.
+         */
+        template <typename Map, typename Visitor>
+        void parallelForEachEntry(  const ParallelPolicy & policy,
+                                    Map & map,
+                                    Visitor && visitor  )
+        {
+            EntryPartition<Map> partition(map, policy.grainFor(map.size()));
+            policy.threadPool().parallelFor(0, partition.chunkCount(), 1, [&](std::size_t firstChunk, std::size_t lastChunk)
+            {
+                for(std::size_t chunk = firstChunk; chunk < lastChunk; chunk++)
+                {
+                    partition.visit(chunk, visitor);
+                }
+            });
+        }
+
+
+        /**
+         * @brief Folds every entry of map into a T per chunk with accumulate(T &, entry), in parallel, and returns the chunks'
+         *        results in map order so the caller can combine them deterministically.
+         */
+        template <typename T, typename Map, typename Accumulate>
+        std::vector<T> parallelChunkResults(    const ParallelPolicy & policy,
+                                                Map & map,
+                                                const T & identity,
+                                                Accumulate && accumulate    )
+        {
+            //Each chunk's result gets its own cache line, so threads don't contend over neighbouring results
+            struct alignas(64) Slot
+            {
+                T value;
+            };
+            EntryPartition<Map> partition(map, policy.grainFor(map.size()));
+            std::vector<Slot> slots(partition.chunkCount(), Slot{identity});
+            policy.threadPool().parallelFor(0, partition.chunkCount(), 1, [&](std::size_t firstChunk, std::size_t lastChunk)
+            {
+                for(std::size_t chunk = firstChunk; chunk < lastChunk; chunk++)
+                {
+                    partition.visit(chunk, [&](auto && entry) { accumulate(slots[chunk].value, entry); });
+                }
+            });
+
+            std::vector<T> results;
+            results.reserve(slots.size());
+            for(Slot & slot : slots)
+            {
+                results.push_back(std::move(slot.value));
+            }
+            return results;
+        }
+    }
+
+
+    /**
+     * @brief The same as sumAllValues(map, initialValue), but sums chunks of the map in parallel on policy's pool. Hash maps
+     *        are summed in bucket order, which only matters for values whose + isn't associative, like floating point.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    V sumAllValues( const ParallelPolicy & policy,
+                    const M<K,V,Args...> & map,
+                    V initialValue = 0  )
+    {
+        V sum = initialValue;
+        for(V & partialSum : detail::parallelChunkResults(policy, map, V(0), [](V & partial, const auto & entry) { partial += entry.second; }))
+        {
+            sum += partialSum;
+        }
+        return sum;
+    }
+
+
+    /**
+     * @brief The same as getPairWithMaxValue(map), but searches chunks of the map in parallel on policy's pool. Ties go to the
+     *        pair that comes first in the map's partition order, which is bucket order for hash maps.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    std::pair<K,V> getPairWithMaxValue( const ParallelPolicy & policy,
+                                        const M<K,V,Args...> & map  )
+    {
+        if(map.empty())
+        {
+            throw std::invalid_argument("stevensMapLib::getPairWithMaxValue() cannot get a pair from an empty map");
+        }
+
+        std::optional< std::pair<K,V> > maxPair;
+        auto keepMax = [](std::optional< std::pair<K,V> > & best, const auto & entry)
+        {
+            if(!best || entry.second > best->second)
+            {
+                best.emplace(entry.first, entry.second);
+            }
+        };
+        for(auto & chunkMax : detail::parallelChunkResults(policy, map, std::optional< std::pair<K,V> >(), keepMax))
+        {
+            if(chunkMax)
+            {
+                keepMax(maxPair, *chunkMax);
+            }
+        }
+        return std::move(*maxPair);
+    }
+
+
+    /**
+     * @brief The same as multiplyWithValues(map, factor), but multiplies the values in parallel on policy's pool.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    M<K,V,Args...> multiplyWithValues(  const ParallelPolicy & policy,
+                                        M<K,V,Args...> map,
+                                        long double factor  )
+    {
+        detail::parallelForEachEntry(policy, map, [factor](auto & entry) { entry.second = entry.second * factor; });
+        return map;
+    }
+
+
+    /**
+     * @brief The same as setNegativeValuesToZero(map), but clamps the values in parallel on policy's pool.
+     */
+    template<typename M>
+    requires requires { typename M::mapped_type; }
+    void setNegativeValuesToZero(   const ParallelPolicy & policy,
+                                    M & map )
+    {
+        using V = typename M::mapped_type;
+        detail::parallelForEachEntry(policy, map, [](auto & entry) { entry.second = std::max(entry.second, V(0)); });
+    }
+
+
+    /**
+     * @brief The same as getPairsWhereKeysStartWith(map, str), but tests the keys in parallel on policy's pool. Maps ordered
+     *        by character already visit only the matching keys, so they use the sequential search.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args, typename S>
+    M<K,V,Args...> getPairsWhereKeysStartWith(  const ParallelPolicy & policy,
+                                                const M<K,V,Args...> & map,
+                                                const S & str   )
+    {
+        if constexpr(detail::isOrderedByLess<M<K,V,Args...>>)
+        {
+            return stevensMapLib::getPairsWhereKeysStartWith(map, str);
+        }
+        else
+        {
+            std::string_view prefix = detail::keyView(str);
+            auto matches = detail::parallelChunkResults(policy, map, std::vector< std::pair<K,V> >(), [prefix](auto & chunkMatches, const auto & entry)
+            {
+                if(detail::keyView(entry.first).starts_with(prefix))
+                {
+                    chunkMatches.emplace_back(entry.first, entry.second);
+                }
+            });
+
+            M<K,V,Args...> returnMap = detail::emptyLike(map, map.get_allocator());
+            for(auto & chunkMatches : matches)
+            {
+                for(auto & [key,value] : chunkMatches)
+                {
+                    returnMap.emplace(std::move(key), std::move(value));
+                }
+            }
+            return returnMap;
+        }
+    }
+
+
+    /**
+     * @brief The same as addMaps(A, B, addOperationTarget, omitKeysNotShared), but looks up and adds the pairs in parallel on
+     *        policy's pool. Only building the result map is sequential.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    M<K,V,Args...> addMaps  (   const ParallelPolicy & policy,
+                                const M<K,V,Args...> & A,
+                                const M<K,V,Args...> & B,
+                                std::string addOperationTarget = "keys and values",
+                                bool omitKeysNotShared = false )
+    {
+        bool valuesOnly = addOperationTarget == "values";
+        auto sums = detail::parallelChunkResults(policy, A, std::vector< std::pair<K,V> >(), [&](auto & chunkSums, const auto & entry)
+        {
+            auto match = B.find(entry.first);
+            if(match != B.end())
+            {
+                chunkSums.emplace_back(valuesOnly ? entry.first : entry.first + entry.first, entry.second + match->second);
+            }
+            else if(!omitKeysNotShared)
+            {
+                chunkSums.emplace_back(entry.first, entry.second);
+            }
+        });
+
+        M<K,V,Args...> AB = detail::emptyLike(A, A.get_allocator());
+        for(auto & chunkSums : sums)
+        {
+            for(auto & [key,value] : chunkSums)
+            {
+                AB.insert_or_assign(std::move(key), std::move(value));
+            }
+        }
+
+        //If we're not omitting shared keys, add the keys from B that were not matched
+        if(!omitKeysNotShared)
+        {
+            auto unmatched = detail::parallelChunkResults(policy, B, std::vector< std::pair<K,V> >(), [&AB](auto & chunkUnmatched, const auto & entry)
+            {
+                if(!AB.contains(entry.first))
+                {
+                    chunkUnmatched.emplace_back(entry.first, entry.second);
+                }
+            });
+            for(auto & chunkUnmatched : unmatched)
+            {
+                for(auto & [key,value] : chunkUnmatched)
+                {
+                    AB.insert_or_assign(std::move(key), std::move(value));
+                }
+            }
+        }
+
+        return AB;
+    }
+
+
+    /**
+     * @brief The same as sumAllValues(const ShardedMap &, initialValue), but sums the shards in parallel on policy's pool,
+     *        each under its own shared lock.
+     */
+    template <typename K, typename V, typename Map, typename ShardHash>
+    V sumAllValues( const ParallelPolicy & policy,
+                    const ShardedMap<K,V,Map,ShardHash> & map,
+                    V initialValue = 0  )
+    {
+        std::vector<V> shardSums(map.shardCount(), V(0));
+        policy.threadPool().parallelFor(0, map.shardCount(), 1, [&](std::size_t firstShard, std::size_t lastShard)
+        {
+            for(std::size_t shard = firstShard; shard < lastShard; shard++)
+            {
+                shardSums[shard] = map.visitShard(shard, [](const Map & shardMap) { return stevensMapLib::sumAllValues(shardMap); });
+            }
+        });
+
+        V sum = initialValue;
+        for(const V & shardSum : shardSums)
+        {
+            sum += shardSum;
+        }
+        return sum;
+    }
+
+
+    /*** Aggregating maps ***/
+    /**
+     * @brief A map that keeps the sum, count, minimum and maximum of its values up to date as it changes, so
+     *        sumAllValues() and getPairWithMaxValue() on it take O(1) time instead of a full scan. Values can only be changed
+     *        through its own methods, which update the aggregates. When the pair holding the minimum or maximum is erased or
+     *        moved away from the extreme, that extreme is recomputed with one scan the next time it's asked for.
+     * 
+     * Example: stevensMapLib::AggregatingMap<std::string,int> latencies;
+     *          latencies.insert_or_assign("backendA", 12);
+     *          latencies.insert_or_assign("backendB", 30);
+     *          int total = stevensMapLib::sumAllValues(latencies); //42, without visiting either pair
+     * 
+     * @tparam K The type of keys in the map.
+     * @tparam V The numeric type of values in the map. For floating point values the running sum can drift from a fresh
+     *           sum after many updates; recomputeSum() resets it.
+     * @tparam Map The maplike type that stores the pairs.
+     */
+    template <typename K, typename V, typename Map = std::unordered_map<K,V>>
+    class AggregatingMap
+    {
+        public:
+            using key_type = K;
+            using mapped_type = V;
+            using value_type = typename Map::value_type;
+            using size_type = typename Map::size_type;
+            using iterator = typename Map::const_iterator;
+            using const_iterator = typename Map::const_iterator;
+            using allocator_type = typename Map::allocator_type;
+
+            AggregatingMap() = default;
+
+            explicit AggregatingMap(    Map map ) : m_map(std::move(map))
+            {
+                recomputeSum();
+                m_minStale = m_maxStale = !m_map.empty();
+            }
+
+            /**
+             * @brief Inserts value under key, or replaces the value already there.
+             * 
+             * @return Whether key was inserted rather than assigned.
+             */
+            bool insert_or_assign(  const K & key,
+                                    V value )
+            {
+                auto [it, inserted] = m_map.try_emplace(key, value);
+                if(inserted)
+                {
+                    m_sum += value;
+                    noteRaised(it->first, value);
+                    noteLowered(it->first, value);
+                }
+                else
+                {
+                    replaceValue(it, value);
+                }
+                return inserted;
+            }
+
+            /**
+             * @brief Calls fn on the value of key, inserting a value-initialized one first if key isn't present, and updates
+             *        the aggregates with the result.
+             */
+            template <typename F>
+            void update(    const K & key,
+                            F && fn )
+            {
+                auto [it, inserted] = m_map.try_emplace(key);
+                if(inserted)
+                {
+                    noteRaised(it->first, it->second);
+                    noteLowered(it->first, it->second);
+                    m_sum += it->second;
+                }
+                V value = it->second;
+                fn(value);
+                replaceValue(it, value);
+            }
+
+            size_type erase(    const K & key   )
+            {
+                auto it = m_map.find(key);
+                if(it == m_map.end())
+                {
+                    return 0;
+                }
+                m_sum -= it->second;
+                bool wasMax = m_max && !m_maxStale && m_max->first == key;
+                bool wasMin = m_min && !m_minStale && m_min->first == key;
+                m_map.erase(it);
+                m_maxStale = m_maxStale || wasMax;
+                m_minStale = m_minStale || wasMin;
+                if(m_map.empty())
+                {
+                    m_max.reset();
+                    m_min.reset();
+                    m_maxStale = m_minStale = false;
+                }
+                return 1;
+            }
+
+            void clear()
+            {
+                m_map.clear();
+                m_sum = V(0);
+                m_max.reset();
+                m_min.reset();
+                m_maxStale = m_minStale = false;
+            }
+
+            /**
+             * @brief The sum of every value, in O(1).
+             */
+            V sum() const noexcept
+            {
+                return m_sum;
+            }
+
+            /**
+             * @brief The number of pairs, in O(1).
+             */
+            size_type count() const noexcept
+            {
+                return m_map.size();
+            }
+
+            /**
+             * @brief The pair with the greatest value, in O(1) unless it has to be recomputed.
+             * 
+             * @throws std::invalid_argument if the map is empty.
+             */
+            const std::pair<K,V> & max() const
+            {
+                if(m_map.empty())
+                {
+                    throw std::invalid_argument("stevensMapLib::AggregatingMap::max() cannot get a pair from an empty map");
+                }
+                if(m_maxStale)
+                {
+                    auto best = std::max_element(m_map.begin(), m_map.end(), [](const auto & a, const auto & b) { return a.second < b.second; });
+                    m_max.emplace(best->first, best->second);
+                    m_maxStale = false;
+                }
+                return *m_max;
+            }
+
+            /**
+             * @brief The pair with the least value, in O(1) unless it has to be recomputed.
+             * 
+             * @throws std::invalid_argument if the map is empty.
+             */
+            const std::pair<K,V> & min() const
+            {
+                if(m_map.empty())
+                {
+                    throw std::invalid_argument("stevensMapLib::AggregatingMap::min() cannot get a pair from an empty map");
+                }
+                if(m_minStale)
+                {
+                    auto best = std::min_element(m_map.begin(), m_map.end(), [](const auto & a, const auto & b) { return a.second < b.second; });
+                    m_min.emplace(best->first, best->second);
+                    m_minStale = false;
+                }
+                return *m_min;
+            }
+
+            /**
+             * @brief Resets the running sum to a fresh sum of every value.
+             */
+            void recomputeSum()
+            {
+                m_sum = V(0);
+                for(const auto & [key,value] : m_map)
+                {
+                    m_sum += value;
+                }
+            }
+
+            //Read-only access, so the library's other functions work on an AggregatingMap without bypassing its aggregates
+            const_iterator begin() const noexcept { return m_map.begin(); }
+            const_iterator end() const noexcept { return m_map.end(); }
+            const_iterator find(    const K & key   ) const { return m_map.find(key); }
+            bool contains(  const K & key   ) const { return m_map.contains(key); }
+            const V & at(   const K & key   ) const { return m_map.at(key); }
+            size_type size() const noexcept { return m_map.size(); }
+            bool empty() const noexcept { return m_map.empty(); }
+            allocator_type get_allocator() const { return m_map.get_allocator(); }
+            const Map & map() const noexcept { return m_map; }
+
+        private:
+            void replaceValue(  typename Map::iterator it,
+                                V value )
+            {
+                V previous = it->second;
+                it->second = value;
+                m_sum += value - previous;
+                if(value > previous)
+                {
+                    noteRaised(it->first, value);
+                    //The minimum may have moved to another pair
+                    m_minStale = m_minStale || (m_min && m_min->first == it->first);
+                }
+                else if(value < previous)
+                {
+                    noteLowered(it->first, value);
+                    m_maxStale = m_maxStale || (m_max && m_max->first == it->first);
+                }
+            }
+
+            //A pair's value rose to value, so it may now be the maximum, or still be the maximum with a new value
+            void noteRaised(    const K & key,
+                                const V & value )
+            {
+                if(m_maxStale)
+                {
+                    return;
+                }
+                if(!m_max || value > m_max->second || m_max->first == key)
+                {
+                    m_max.emplace(key, value);
+                }
+            }
+
+            void noteLowered(   const K & key,
+                                const V & value )
+            {
+                if(m_minStale)
+                {
+                    return;
+                }
+                if(!m_min || value < m_min->second || m_min->first == key)
+                {
+                    m_min.emplace(key, value);
+                }
+            }
+
+            Map m_map;
+            V m_sum = V(0);
+            mutable std::optional< std::pair<K,V> > m_max;
+            mutable std::optional< std::pair<K,V> > m_min;
+            mutable bool m_maxStale = false;
+            mutable bool m_minStale = false;
+    };
+
+
+    /**
+     * @brief Returns the running sum of an AggregatingMap added to initialValue, in O(1).
+     */
+    template <typename K, typename V, typename Map>
+    V sumAllValues( const AggregatingMap<K,V,Map> & map,
+                    V initialValue = 0  )
+    {
+        return initialValue + map.sum();
+    }
+
+
+    /**
+     * @brief Returns the pair of an AggregatingMap with the greatest value, in O(1) unless it has to be recomputed. If more
+     *        than one pair has the greatest value, any of them may be returned.
+     * 
+     * @throws std::invalid_argument if the map is empty.
+     */
+    template <typename K, typename V, typename Map>
+    std::pair<K,V> getPairWithMaxValue( const AggregatingMap<K,V,Map> & map )
+    {
+        if(map.empty())
+        {
+            throw std::invalid_argument("stevensMapLib::getPairWithMaxValue() cannot get a pair from an empty map");
+        }
+        return map.max();
+    }
+
+
+    /*** Weighted sampling ***/
+    namespace detail
+    {
+        /**
+         * @brief The weight a sampler gives a value: exact unsigned integers for integral values, doubles otherwise.
+         */
+        template <typename V>
+        using SamplingWeight = std::conditional_t<std::is_integral_v<V>, std::uint64_t, double>;
+
+        template <typename V>
+        SamplingWeight<V> samplingWeight(   const V & value,
+                                            const char * functionName   )
+        {
+            if(!(value >= 0))
+            {
+                throw std::invalid_argument(std::string("stevensMapLib::") + functionName + "() cannot sample with a negative weight");
+            }
+            return static_cast<SamplingWeight<V>>(value);
+        }
+
+        //Draws a weight uniformly from [0, total)
+        template <typename Weight, typename URBG>
+        Weight drawWeight(  Weight total,
+                            URBG & rng  )
+        {
+            if constexpr(std::is_integral_v<Weight>)
+            {
+                return std::uniform_int_distribution<Weight>(0, total - 1)(rng);
+            }
+            else
+            {
+                return std::uniform_real_distribution<Weight>(0, total)(rng);
+            }
+        }
+    }
+
+
+    /**
+     * @brief Samples the keys of a map that doesn't change in proportion to their values, in O(1) per draw, using Vose's alias
+     *        method. Building it takes O(n). It points at the map's pairs rather than copying them, so the map must outlive
+     *        it, and any change to the map needs a new sampler.
+     * 
+     * Example: stevensMapLib::AliasSampler sampler(backendWeights);
+     *          std::mt19937_64 rng(std::random_device{}());
+     *          const std::string & backend = sampler.sample(rng);
+     * 
+     * @tparam Map The maplike type with non-negative numeric values, whose iterators refer to stored pairs.
+     */
+    template <typename Map>
+    class AliasSampler
+    {
+        public:
+            using value_type = typename Map::value_type;
+            using key_type = typename Map::key_type;
+
+            /**
+             * @throws std::invalid_argument if map is empty, has a negative value, or its values sum to zero.
+             */
+            explicit AliasSampler(  const Map & map )
+            {
+                static_assert(std::is_lvalue_reference_v<decltype(*map.begin())>, "AliasSampler needs a map whose iterators refer to stored pairs");
+                std::vector<double> scaled;
+                m_entries.reserve(map.size());
+                scaled.reserve(map.size());
+                double total = 0;
+                for(const auto & entry : map)
+                {
+                    m_entries.push_back(&entry);
+                    scaled.push_back(double(detail::samplingWeight(entry.second, "AliasSampler")));
+                    total += scaled.back();
+                }
+                if(m_entries.empty() || !(total > 0))
+                {
+                    throw std::invalid_argument("stevensMapLib::AliasSampler() needs a map with at least one positive value");
+                }
+
+                //Scale the weights so they average 1, then pair each light slot with a heavy entry that tops it up to 1
+                std::size_t n = m_entries.size();
+                m_probability.resize(n);
+                m_alias.resize(n);
+                std::vector<std::size_t> light, heavy;
+                for(std::size_t i = 0; i < n; i++)
+                {
+                    scaled[i] *= double(n) / total;
+                    (scaled[i] < 1.0 ? light : heavy).push_back(i);
+                }
+                while(!light.empty() && !heavy.empty())
+                {
+                    std::size_t small = light.back();
+                    light.pop_back();
+                    std::size_t large = heavy.back();
+                    m_probability[small] = scaled[small];
+                    m_alias[small] = large;
+                    scaled[large] -= 1.0 - scaled[small];
+                    if(scaled[large] < 1.0)
+                    {
+                        heavy.pop_back();
+                        light.push_back(large);
+                    }
+                }
+                //Whatever is left is 1 up to rounding error
+                for(std::size_t i : heavy)
+                {
+                    m_probability[i] = 1.0;
+                    m_alias[i] = i;
+                }
+                for(std::size_t i : light)
+                {
+                    m_probability[i] = 1.0;
+                    m_alias[i] = i;
+                }
+            }
+
+            /**
+             * @brief Draws a pair with probability proportional to its value.
+             */
+            template <typename URBG>
+            const value_type & samplePair(  URBG & rng  ) const
+            {
+                std::size_t slot = std::uniform_int_distribution<std::size_t>(0, m_entries.size() - 1)(rng);
+                double coin = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+                return *m_entries[coin < m_probability[slot] ? slot : m_alias[slot]];
+            }
+
+            /**
+             * @brief Draws a key with probability proportional to its value.
+             */
+            template <typename URBG>
+            const key_type & sample(    URBG & rng  ) const
+            {
+                return samplePair(rng).first;
+            }
+
+            std::size_t size() const noexcept
+            {
+                return m_entries.size();
+            }
+
+        private:
+            std::vector<const value_type *> m_entries;
+            std::vector<double> m_probability;
+            std::vector<std::size_t> m_alias;
+    };
+
+
+    /**
+     * @brief Samples the keys of a map in proportion to their values in O(log n) per draw, using a Fenwick tree of the values
+     *        so that a changed value costs O(log n) to update rather than a rebuild. It points at the map's pairs rather than
+     *        copying them, so the map must outlive it, and must be a node-based map like std::map or std::unordered_map whose
+     *        pairs don't move. After changing or inserting a pair call update(key), and call erase(key) before erasing one.
+     *        An erased pair's slot is reused by the next pair added, so the sampler only grows to the most pairs it has held at once.
+     * 
+     * Example: stevensMapLib::FenwickSampler sampler(backendWeights);
+     *          backendWeights["backendA"] = 0;
+     *          sampler.update("backendA");
+     *          const std::string & backend = sampler.sample(rng);
+     * 
+     * @tparam Map The node-based maplike type with non-negative numeric values.
+     */
+    template <typename Map>
+    class FenwickSampler
+    {
+        public:
+            using value_type = typename Map::value_type;
+            using key_type = typename Map::key_type;
+            using Weight = detail::SamplingWeight<typename Map::mapped_type>;
+
+            /**
+             * @throws std::invalid_argument if map has a negative value.
+             */
+            explicit FenwickSampler(    const Map & map ) : m_map(&map)
+            {
+                static_assert(std::is_lvalue_reference_v<decltype(*map.begin())>, "FenwickSampler needs a map whose iterators refer to stored pairs");
+                m_entries.reserve(map.size());
+                m_weights.reserve(map.size());
+                for(const auto & entry : map)
+                {
+                    m_positions.emplace(&entry, m_entries.size());
+                    m_entries.push_back(&entry);
+                    m_weights.push_back(detail::samplingWeight(entry.second, "FenwickSampler"));
+                    m_liveCount += m_weights.back() > Weight(0) ? 1 : 0;
+                }
+                rebuild();
+            }
+
+            /**
+             * @brief Rereads the value of key from the map, adding key to the sampler if it was inserted since.
+             * 
+             * @throws std::out_of_range if key isn't in the map.
+             */
+            void update(    const key_type & key    )
+            {
+                auto it = m_map->find(key);
+                if(it == m_map->end())
+                {
+                    throw std::out_of_range("stevensMapLib::FenwickSampler::update() the key isn't in the map");
+                }
+                Weight weight = detail::samplingWeight(it->second, "FenwickSampler::update");
+                auto position = m_positions.find(&*it);
+                if(position == m_positions.end())
+                {
+                    add(&*it, weight);
+                }
+                else
+                {
+                    setWeight(position->second, weight);
+                }
+            }
+
+            /**
+             * @brief Stops sampling key. Call this before erasing key from the map.
+             */
+            void erase( const key_type & key    )
+            {
+                auto it = m_map->find(key);
+                if(it == m_map->end())
+                {
+                    return;
+                }
+                auto position = m_positions.find(&*it);
+                if(position != m_positions.end())
+                {
+                    m_freeSlots.push_back(position->second);
+                    setWeight(position->second, Weight(0));
+                    m_entries[position->second] = nullptr;
+                    m_positions.erase(position);
+                }
+            }
+
+            /**
+             * @brief Draws a pair with probability proportional to its value.
+             * 
+             * @throws std::invalid_argument if every value is zero.
+             */
+            template <typename URBG>
+            const value_type & samplePair(  URBG & rng  ) const
+            {
+                if(m_liveCount == 0 || !(m_total > 0))
+                {
+                    throw std::invalid_argument("stevensMapLib::FenwickSampler::sample() cannot sample when every weight is zero");
+                }
+                Weight remaining = detail::drawWeight(m_total, rng);
+                //Descend the tree for the first position whose prefix sum exceeds the draw
+                std::size_t position = 0;
+                for(std::size_t step = std::bit_floor(m_entries.size()); step > 0; step >>= 1)
+                {
+                    if(position + step < m_tree.size() && m_tree[position + step] <= remaining)
+                    {
+                        position += step;
+                        remaining -= m_tree[position];
+                    }
+                }
+                //Floating point rounding can run off the end or onto a zero weight, so fall back to the nearest live pair
+                position = std::min(position, m_entries.size() - 1);
+                for(std::size_t below = position + 1; below > 0; below--)
+                {
+                    if(isLive(below - 1))
+                    {
+                        return *m_entries[below - 1];
+                    }
+                }
+                for(std::size_t above = position + 1; above < m_entries.size(); above++)
+                {
+                    if(isLive(above))
+                    {
+                        return *m_entries[above];
+                    }
+                }
+                throw std::logic_error("stevensMapLib::FenwickSampler::sample() no pair has a positive weight");
+            }
+
+            /**
+             * @brief Draws a key with probability proportional to its value.
+             */
+            template <typename URBG>
+            const key_type & sample(    URBG & rng  ) const
+            {
+                return samplePair(rng).first;
+            }
+
+            /**
+             * @brief The sum of every sampled value.
+             */
+            Weight totalWeight() const noexcept
+            {
+                return m_total;
+            }
+
+        private:
+            bool isLive(    std::size_t position    ) const noexcept
+            {
+                return m_entries[position] != nullptr && m_weights[position] > Weight(0);
+            }
+
+            /**
+             * @brief Recomputes the tree and the total from the weights in O(n), discarding any rounding error the updates built up.
+             */
+            void rebuild()
+            {
+                m_tree.assign(m_weights.size() + 1, Weight(0));
+                m_total = 0;
+                for(std::size_t i = 0; i < m_weights.size(); i++)
+                {
+                    m_tree[i + 1] = m_weights[i];
+                    m_total += m_weights[i];
+                }
+                //Build the tree in O(n) by pushing each node's sum up to its parent
+                for(std::size_t i = 1; i < m_tree.size(); i++)
+                {
+                    std::size_t parent = i + (i & (~i + 1));
+                    if(parent < m_tree.size())
+                    {
+                        m_tree[parent] += m_tree[i];
+                    }
+                }
+                m_updatesSinceRebuild = 0;
+            }
+
+            void setWeight( std::size_t position,
+                            Weight weight   )
+            {
+                m_liveCount -= m_weights[position] > Weight(0) ? 1 : 0;
+                m_liveCount += weight > Weight(0) ? 1 : 0;
+                //Unsigned weights wrap around when lowered, which the tree's sums undo exactly
+                Weight delta = weight - m_weights[position];
+                m_weights[position] = weight;
+                if constexpr(std::is_floating_point_v<Weight>)
+                {
+                    //Floating point sums drift as weights go up and down, leaving a small positive total after every weight
+                    //has been set to zero. Rebuilding once per n updates keeps the drift bounded at O(1) amortized cost
+                    if(m_liveCount == 0 || ++m_updatesSinceRebuild >= m_weights.size())
+                    {
+                        rebuild();
+                        return;
+                    }
+                }
+                m_total += delta;
+                for(std::size_t i = position + 1; i < m_tree.size(); i += i & (~i + 1))
+                {
+                    m_tree[i] += delta;
+                }
+            }
+
+            Weight prefixSum(   std::size_t count   ) const
+            {
+                Weight sum = 0;
+                for(std::size_t i = count; i > 0; i -= i & (~i + 1))
+                {
+                    sum += m_tree[i];
+                }
+                return sum;
+            }
+
+            void add(   const value_type * entry,
+                        Weight weight   )
+            {
+                //Reuse a slot freed by erase() if there is one, so keys that come and go don't grow the tree without bound
+                if(!m_freeSlots.empty())
+                {
+                    std::size_t position = m_freeSlots.back();
+                    m_positions.emplace(entry, position);
+                    m_freeSlots.pop_back();
+                    m_entries[position] = entry;
+                    setWeight(position, weight);
+                    return;
+                }
+                //The new node covers itself and the positions below it that its lowest set bit spans
+                std::size_t index = m_tree.size();
+                std::size_t span = index & (~index + 1);
+                m_tree.push_back(weight + prefixSum(index - 1) - prefixSum(index - span));
+                m_positions.emplace(entry, m_entries.size());
+                m_entries.push_back(entry);
+                m_weights.push_back(weight);
+                m_total += weight;
+                m_liveCount += weight > Weight(0) ? 1 : 0;
+            }
+
+            const Map * m_map;
+            std::vector<const value_type *> m_entries;
+            std::vector<Weight> m_weights;
+            std::vector<Weight> m_tree;
+            std::unordered_map<const value_type *, std::size_t> m_positions;
+            //Slots of erased pairs, which hold a zero weight until add() reuses them
+            std::vector<std::size_t> m_freeSlots;
+            Weight m_total = 0;
+            //The number of pairs with a positive weight, so an all-zero sampler is recognised exactly whatever the total has drifted to
+            std::size_t m_liveCount = 0;
+            std::size_t m_updatesSinceRebuild = 0;
+    };
+
+
+    /**
+     * @brief Gets a random key from a maplike object with probability proportional to its value, in one O(n) pass. For
+     *        repeated draws, build an AliasSampler or FenwickSampler instead.
+     * 
+     * @param map The maplike object with non-negative numeric values we are picking a key from.
+     * @param rng The uniform random bit generator to draw with, e.g. std::mt19937_64.
+     * @return A key found in map.
+     * @throws std::invalid_argument if map has a negative value or no positive one.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args, typename URBG>
+    K getWeightedRandomKey( const M<K,V,Args...> & map,
+                            URBG & rng  )
+    {
+        using Weight = detail::SamplingWeight<V>;
+        Weight total = 0;
+        for(const auto & [key,value] : map)
+        {
+            total += detail::samplingWeight(value, "getWeightedRandomKey");
+        }
+        if(!(total > 0))
+        {
+            throw std::invalid_argument("stevensMapLib::getWeightedRandomKey() needs a map with at least one positive value");
+        }
+        Weight remaining = detail::drawWeight(total, rng);
+        const K * chosen = nullptr;
+        for(const auto & [key,value] : map)
+        {
+            Weight weight = static_cast<Weight>(value);
+            if(weight > 0)
+            {
+                chosen = &key;
+                if(remaining < weight)
+                {
+                    break;
+                }
+                remaining -= weight;
+            }
+        }
+        return *chosen;
+    }
+
+
+    /*** Sampling without replacement ***/
+    namespace detail
+    {
+        /**
+         * @brief Chooses k distinct positions in [0, n) uniformly at random with Floyd's algorithm, which draws exactly k
+         *        numbers however close k is to n, and returns them in increasing order.
+         */
+        template <typename URBG>
+        std::vector<std::size_t> samplePositions(   std::size_t n,
+                                                    std::size_t k,
+                                                    URBG & rng  )
+        {
+            k = std::min(k, n);
+            std::unordered_set<std::size_t> chosen;
+            chosen.reserve(k);
+            for(std::size_t j = n - k; j < n; j++)
+            {
+                std::size_t position = std::uniform_int_distribution<std::size_t>(0, j)(rng);
+                //If position was already chosen, j can't have been, since every earlier draw was below j
+                chosen.insert(chosen.contains(position) ? j : position);
+            }
+            std::vector<std::size_t> positions(chosen.begin(), chosen.end());
+            std::sort(positions.begin(), positions.end());
+            return positions;
+        }
+
+        /**
+         * @brief Walks map once, as far as the last sampled position, calling visit on the pair at each sampled position.
+         */
+        template <typename Map, typename Visit>
+        void visitSampled(  const Map & map,
+                            const std::vector<std::size_t> & positions,
+                            Visit && visit  )
+        {
+            auto it = map.begin();
+            std::size_t current = 0;
+            for(std::size_t position : positions)
+            {
+                std::ranges::advance(it, static_cast<std::ptrdiff_t>(position - current));
+                current = position;
+                visit(*it);
+            }
+        }
+    }
+
+
+    /**
+     * @brief Gets k distinct random keys from a maplike object, each set of k keys being equally likely, in a single walk of
+     *        the map. The positions to keep are chosen first, so the walk works on forward-only maps like std::unordered_map
+     *        and stops at the last chosen position.
+     * 
+     * Example: std::mt19937_64 rng(std::random_device{}());
+     *          std::vector<std::string> cohort = stevensMapLib::sampleKeys(users, 10000, rng);
+     * 
+     * @param map The maplike object we are sampling keys from.
+     * @param k The number of keys to sample. If the map has fewer than k keys, all of them are returned.
+     * @param rng The uniform random bit generator to draw with, e.g. std::mt19937_64.
+     * @return min(k, map.size()) distinct keys, in the order they appear in the map.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args, typename URBG>
+    std::vector<K> sampleKeys(  const M<K,V,Args...> & map,
+                                std::size_t k,
+                                URBG & rng  )
+    {
+        std::vector<std::size_t> positions = detail::samplePositions(map.size(), k, rng);
+        std::vector<K> keys;
+        keys.reserve(positions.size());
+        detail::visitSampled(map, positions, [&keys](const auto & entry) { keys.push_back(entry.first); });
+        return keys;
+    }
+
+
+    /**
+     * @brief The same as sampleKeys(map, k, rng), but returns the sampled key-value pairs.
+     * 
+     * @return min(k, map.size()) distinct pairs, in the order they appear in the map.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args, typename URBG>
+    std::vector< std::pair<K,V> > samplePairs(  const M<K,V,Args...> & map,
+                                                std::size_t k,
+                                                URBG & rng  )
+    {
+        std::vector<std::size_t> positions = detail::samplePositions(map.size(), k, rng);
+        std::vector< std::pair<K,V> > pairs;
+        pairs.reserve(positions.size());
+        detail::visitSampled(map, positions, [&pairs](const auto & entry) { pairs.emplace_back(entry.first, entry.second); });
+        return pairs;
+    }
+
+
+    /*** Order statistic maps ***/
+    /**
+     * @brief An ordered map that also knows the position of every key, so it can find the i-th key, the rank of a key, or a
+     *        uniformly random key in O(log n) expected time, where std::map has to walk i nodes. It's a treap: a binary search
+     *        tree kept balanced by random priorities, whose nodes record the size of their subtree and their parent.
+     *        It has the interface of std::map, so the library's other functions work on it.
+     * 
+     * Example: stevensMapLib::OrderStatisticMap<int,std::string> scores = {{70,"c"}, {95,"a"}, {82,"b"}};
+     *          scores.nth(1)->first;       //82
+     *          scores.rank(90);            //2, the number of keys less than 90
+     *          scores.percentileOf(90);    //0.666...
+     * 
+     * @tparam K The type of keys in the map.
+     * @tparam V The type of values in the map.
+     * @tparam Compare The strict weak ordering of the keys.
+     * @tparam Allocator The allocator of the map's pairs, rebound to allocate its nodes.
+     */
+    template <typename K, typename V, typename Compare = std::less<K>, typename Allocator = std::allocator< std::pair<const K, V> >>
+    class OrderStatisticMap
+    {
+        public:
+            using key_type = K;
+            using mapped_type = V;
+            using value_type = std::pair<const K, V>;
+            using size_type = std::size_t;
+            using difference_type = std::ptrdiff_t;
+            using key_compare = Compare;
+            using allocator_type = Allocator;
+            using reference = value_type &;
+            using const_reference = const value_type &;
+
+        private:
+            struct Node
+            {
+                Node() noexcept {}
+                ~Node() {}
+
+                //Constructed separately through the allocator, so allocators like std::pmr's can pass themselves on to the pair
+                union
+                {
+                    value_type value;
+                };
+                Node * left = nullptr;
+                Node * right = nullptr;
+                Node * parent = nullptr;
+                size_type size = 1;
+                std::uint64_t priority = 0;
+            };
+
+            using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+            using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+            template <bool Const>
+            class Iterator
+            {
+                public:
+                    using iterator_category = std::bidirectional_iterator_tag;
+                    using value_type = OrderStatisticMap::value_type;
+                    using difference_type = std::ptrdiff_t;
+                    using pointer = std::conditional_t<Const, const value_type *, value_type *>;
+                    using reference = std::conditional_t<Const, const value_type &, value_type &>;
+
+                    Iterator() = default;
+
+                    //Lets an iterator convert to a const_iterator
+                    template <bool OtherConst>
+                    requires (Const && !OtherConst)
+                    Iterator(   const Iterator<OtherConst> & other  ) noexcept : m_node(other.m_node), m_map(other.m_map) {}
+
+                    reference operator*() const noexcept { return m_node->value; }
+                    pointer operator->() const noexcept { return &m_node->value; }
+
+                    Iterator & operator++() noexcept
+                    {
+                        m_node = OrderStatisticMap::successor(m_node);
+                        return *this;
+                    }
+
+                    Iterator operator++(int) noexcept
+                    {
+                        Iterator previous = *this;
+                        ++*this;
+                        return previous;
+                    }
+
+                    Iterator & operator--() noexcept
+                    {
+                        m_node = m_node ? OrderStatisticMap::predecessor(m_node) : OrderStatisticMap::rightmost(m_map->m_root);
+                        return *this;
+                    }
+
+                    Iterator operator--(int) noexcept
+                    {
+                        Iterator previous = *this;
+                        --*this;
+                        return previous;
+                    }
+
+                    bool operator==(    const Iterator & other  ) const noexcept { return m_node == other.m_node; }
+
+                private:
+                    friend class OrderStatisticMap;
+                    template <bool> friend class Iterator;
+
+                    Iterator(   Node * node,
+                                const OrderStatisticMap * map   ) noexcept : m_node(node), m_map(map) {}
+
+                    Node * m_node = nullptr;
+                    const OrderStatisticMap * m_map = nullptr;
+            };
+
+        public:
+            using iterator = Iterator<false>;
+            using const_iterator = Iterator<true>;
+
+            OrderStatisticMap() = default;
+
+            explicit OrderStatisticMap( const Compare & compare,
+                                        const Allocator & allocator = Allocator()   ) : m_compare(compare), m_allocator(allocator) {}
+
+            explicit OrderStatisticMap( const Allocator & allocator ) : m_allocator(allocator) {}
+
+            OrderStatisticMap(  std::initializer_list<value_type> pairs,
+                                const Compare & compare = Compare(),
+                                const Allocator & allocator = Allocator()   ) : m_compare(compare), m_allocator(allocator)
+            {
+                for(const value_type & pair : pairs)
+                {
+                    insert(pair);
+                }
+            }
+
+            OrderStatisticMap(  const OrderStatisticMap & other ) : OrderStatisticMap(other, NodeTraits::select_on_container_copy_construction(other.m_allocator)) {}
+
+            OrderStatisticMap(  const OrderStatisticMap & other,
+                                const Allocator & allocator ) : m_compare(other.m_compare), m_allocator(allocator), m_seed(other.m_seed)
+            {
+                m_root = clone(other.m_root, nullptr);
+            }
+
+            OrderStatisticMap(  OrderStatisticMap && other  ) noexcept : m_compare(std::move(other.m_compare)), m_allocator(std::move(other.m_allocator)),
+                                                                         m_root(std::exchange(other.m_root, nullptr)), m_seed(other.m_seed) {}
+
+            /**
+             * @brief Takes other's nodes if allocator equals other's allocator, and otherwise moves its pairs one by one into
+             *        nodes from allocator.
+             */
+            OrderStatisticMap(  OrderStatisticMap && other,
+                                const Allocator & allocator ) : m_compare(other.m_compare), m_allocator(allocator), m_seed(other.m_seed)
+            {
+                if(NodeTraits::is_always_equal::value || m_allocator == other.m_allocator)
+                {
+                    m_root = std::exchange(other.m_root, nullptr);
+                }
+                else
+                {
+                    moveElementsFrom(other);
+                }
+            }
+
+            //Follows the allocator's propagation traits like the standard containers, so allocators that don't propagate, such as
+            //std::pmr::polymorphic_allocator, keep allocating from their own resource
+            OrderStatisticMap & operator=(  const OrderStatisticMap & other )
+            {
+                if(this != &other)
+                {
+                    if constexpr(NodeTraits::propagate_on_container_copy_assignment::value)
+                    {
+                        OrderStatisticMap copy(other, Allocator(other.m_allocator));
+                        //The old nodes must go back to the old allocator before it's replaced
+                        clear();
+                        m_allocator = other.m_allocator;
+                        adoptTree(copy);
+                    }
+                    else
+                    {
+                        OrderStatisticMap copy(other, Allocator(m_allocator));
+                        adoptTree(copy);
+                    }
+                }
+                return *this;
+            }
+
+            OrderStatisticMap & operator=(  OrderStatisticMap && other  ) noexcept(NodeTraits::propagate_on_container_move_assignment::value || NodeTraits::is_always_equal::value)
+            {
+                if(this != &other)
+                {
+                    if constexpr(NodeTraits::propagate_on_container_move_assignment::value)
+                    {
+                        clear();
+                        m_allocator = std::move(other.m_allocator);
+                        adoptTree(other);
+                    }
+                    else if(NodeTraits::is_always_equal::value || m_allocator == other.m_allocator)
+                    {
+                        adoptTree(other);
+                    }
+                    else
+                    {
+                        //Other's nodes belong to an allocator this map can't free them with, so only its pairs can be moved
+                        clear();
+                        m_compare = other.m_compare;
+                        m_seed = other.m_seed;
+                        moveElementsFrom(other);
+                    }
+                }
+                return *this;
+            }
+
+            ~OrderStatisticMap()
+            {
+                clear();
+            }
+
+            iterator begin() noexcept { return iterator(leftmost(m_root), this); }
+            const_iterator begin() const noexcept { return const_iterator(leftmost(m_root), this); }
+            const_iterator cbegin() const noexcept { return begin(); }
+            iterator end() noexcept { return iterator(nullptr, this); }
+            const_iterator end() const noexcept { return const_iterator(nullptr, this); }
+            const_iterator cend() const noexcept { return end(); }
+
+            size_type size() const noexcept { return sizeOf(m_root); }
+            bool empty() const noexcept { return m_root == nullptr; }
+            size_type max_size() const noexcept { return NodeTraits::max_size(m_allocator); }
+            key_compare key_comp() const { return m_compare; }
+            allocator_type get_allocator() const { return allocator_type(m_allocator); }
+
+            iterator find(  const K & key   ) { return iterator(findNode(key), this); }
+            const_iterator find(    const K & key   ) const { return const_iterator(findNode(key), this); }
+            bool contains(  const K & key   ) const { return findNode(key) != nullptr; }
+            size_type count(    const K & key   ) const { return contains(key) ? 1 : 0; }
+
+            V & at( const K & key   )
+            {
+                return const_cast<V &>(std::as_const(*this).at(key));
+            }
+
+            const V & at(   const K & key   ) const
+            {
+                Node * node = findNode(key);
+                if(node == nullptr)
+                {
+                    throw std::out_of_range("stevensMapLib::OrderStatisticMap::at() the key isn't in the map");
+                }
+                return node->value.second;
+            }
+
+            V & operator[]( const K & key   )
+            {
+                return try_emplace(key).first->second;
+            }
+
+            iterator lower_bound(   const K & key   ) { return iterator(lowerBoundNode(key), this); }
+            const_iterator lower_bound( const K & key   ) const { return const_iterator(lowerBoundNode(key), this); }
+
+            iterator upper_bound(   const K & key   ) { return iterator(upperBoundNode(key), this); }
+            const_iterator upper_bound( const K & key   ) const { return const_iterator(upperBoundNode(key), this); }
+
+            std::pair<iterator, bool> insert(   const value_type & pair )
+            {
+                return try_emplace(pair.first, pair.second);
+            }
+
+            template <typename... ValueArgs>
+            std::pair<iterator, bool> emplace(  ValueArgs &&... args    )
+            {
+                Node * node = createNode(std::forward<ValueArgs>(args)...);
+                auto [position, inserted] = insertNode(node);
+                if(!inserted)
+                {
+                    destroyNode(node);
+                }
+                return {iterator(position, this), inserted};
+            }
+
+            //The hint is ignored, since a treap insert is O(log n) regardless
+            template <typename... ValueArgs>
+            iterator emplace_hint(  const_iterator,
+                                    ValueArgs &&... args    )
+            {
+                return emplace(std::forward<ValueArgs>(args)...).first;
+            }
+
+            template <typename... ValueArgs>
+            std::pair<iterator, bool> try_emplace(  const K & key,
+                                                    ValueArgs &&... args    )
+            {
+                if(Node * existing = findNode(key))
+                {
+                    return {iterator(existing, this), false};
+                }
+                Node * node = createNode(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<ValueArgs>(args)...));
+                insertNode(node);
+                return {iterator(node, this), true};
+            }
+
+            template <typename T>
+            std::pair<iterator, bool> insert_or_assign( const K & key,
+                                                        T && value  )
+            {
+                auto result = try_emplace(key, std::forward<T>(value));
+                if(!result.second)
+                {
+                    result.first->second = std::forward<T>(value);
+                }
+                return result;
+            }
+
+            size_type erase(    const K & key   )
+            {
+                Node * node = findNode(key);
+                if(node == nullptr)
+                {
+                    return 0;
+                }
+                eraseNode(node);
+                return 1;
+            }
+
+            iterator erase( const_iterator position )
+            {
+                Node * next = successor(position.m_node);
+                eraseNode(position.m_node);
+                return iterator(next, this);
+            }
+
+            //Also takes iterator, so erase(it) isn't ambiguous with erase(key) when K is constructible from an iterator
+            iterator erase( iterator position   )
+            {
+                return erase(const_iterator(position));
+            }
+
+            void clear() noexcept
+            {
+                destroySubtree(m_root);
+                m_root = nullptr;
+            }
+
+            /**
+             * @brief Swaps the contents of the maps, and their allocators if the allocator propagates on swap. Swapping maps
+             *        whose allocators neither propagate nor compare equal is undefined for the standard containers; here it
+             *        falls back to moving the pairs into nodes from the other map's allocator, which can throw.
+             */
+            void swap(  OrderStatisticMap & other   ) noexcept(NodeTraits::propagate_on_container_swap::value || NodeTraits::is_always_equal::value)
+            {
+                if constexpr(!NodeTraits::propagate_on_container_swap::value && !NodeTraits::is_always_equal::value)
+                {
+                    if(m_allocator != other.m_allocator)
+                    {
+                        OrderStatisticMap fromOther(std::move(other), Allocator(m_allocator));
+                        OrderStatisticMap fromThis(std::move(*this), Allocator(other.m_allocator));
+                        adoptTree(fromOther);
+                        other.adoptTree(fromThis);
+                        return;
+                    }
+                }
+                using std::swap;
+                swap(m_compare, other.m_compare);
+                if constexpr(NodeTraits::propagate_on_container_swap::value)
+                {
+                    swap(m_allocator, other.m_allocator);
+                }
+                swap(m_root, other.m_root);
+                swap(m_seed, other.m_seed);
+            }
+
+            friend void swap(   OrderStatisticMap & a,
+                                OrderStatisticMap & b   ) noexcept(noexcept(a.swap(b)))
+            {
+                a.swap(b);
+            }
+
+            /**
+             * @brief The pair at position index in key order, in O(log n), or end() if index is past the last pair.
+             */
+            iterator nth(   size_type index )
+            {
+                return iterator(nthNode(index), this);
+            }
+
+            const_iterator nth( size_type index ) const
+            {
+                return const_iterator(nthNode(index), this);
+            }
+
+            /**
+             * @brief The number of keys less than key, which is key's position if it's in the map, in O(log n).
+             */
+            size_type rank( const K & key   ) const
+            {
+                size_type rank = 0;
+                for(Node * node = m_root; node != nullptr; )
+                {
+                    if(m_compare(node->value.first, key))
+                    {
+                        rank += sizeOf(node->left) + 1;
+                        node = node->right;
+                    }
+                    else
+                    {
+                        node = node->left;
+                    }
+                }
+                return rank;
+            }
+
+            /**
+             * @brief The fraction of keys less than key, from 0 to 1, in O(log n).
+             */
+            double percentileOf(    const K & key   ) const
+            {
+                return empty() ? 0.0 : double(rank(key)) / double(size());
+            }
+
+            /**
+             * @brief The pair below which the fraction percentile of the keys fall, e.g. 0.5 for the median, in O(log n).
+             * 
+             * @throws std::invalid_argument if the map is empty or percentile isn't between 0 and 1.
+             */
+            const_iterator atPercentile(    double percentile   ) const
+            {
+                if(empty() || !(percentile >= 0.0 && percentile <= 1.0))
+                {
+                    throw std::invalid_argument("stevensMapLib::OrderStatisticMap::atPercentile() needs a non-empty map and a percentile between 0 and 1");
+                }
+                return nth(std::min(size() - 1, size_type(percentile * double(size()))));
+            }
+
+            friend bool operator==( const OrderStatisticMap & a,
+                                    const OrderStatisticMap & b )
+            {
+                return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+            }
+
+        private:
+            static size_type sizeOf(    const Node * node   ) noexcept
+            {
+                return node ? node->size : 0;
+            }
+
+            static Node * leftmost( Node * node ) noexcept
+            {
+                while(node && node->left)
+                {
+                    node = node->left;
+                }
+                return node;
+            }
+
+            static Node * rightmost(    Node * node ) noexcept
+            {
+                while(node && node->right)
+                {
+                    node = node->right;
+                }
+                return node;
+            }
+
+            static Node * successor(    Node * node ) noexcept
+            {
+                if(node->right)
+                {
+                    return leftmost(node->right);
+                }
+                while(node->parent && node->parent->right == node)
+                {
+                    node = node->parent;
+                }
+                return node->parent;
+            }
+
+            static Node * predecessor(  Node * node ) noexcept
+            {
+                if(node->left)
+                {
+                    return rightmost(node->left);
+                }
+                while(node->parent && node->parent->left == node)
+                {
+                    node = node->parent;
+                }
+                return node->parent;
+            }
+
+            Node * findNode(    const K & key   ) const
+            {
+                Node * node = lowerBoundNode(key);
+                return node && !m_compare(key, node->value.first) ? node : nullptr;
+            }
+
+            Node * lowerBoundNode(  const K & key   ) const
+            {
+                Node * bound = nullptr;
+                for(Node * node = m_root; node != nullptr; )
+                {
+                    if(m_compare(node->value.first, key))
+                    {
+                        node = node->right;
+                    }
+                    else
+                    {
+                        bound = node;
+                        node = node->left;
+                    }
+                }
+                return bound;
+            }
+
+            Node * upperBoundNode(  const K & key   ) const
+            {
+                Node * bound = nullptr;
+                for(Node * node = m_root; node != nullptr; )
+                {
+                    if(m_compare(key, node->value.first))
+                    {
+                        bound = node;
+                        node = node->left;
+                    }
+                    else
+                    {
+                        node = node->right;
+                    }
+                }
+                return bound;
+            }
+
+            Node * nthNode( size_type index ) const
+            {
+                Node * node = m_root;
+                while(node != nullptr)
+                {
+                    size_type leftSize = sizeOf(node->left);
+                    if(index < leftSize)
+                    {
+                        node = node->left;
+                    }
+                    else if(index == leftSize)
+                    {
+                        return node;
+                    }
+                    else
+                    {
+                        index -= leftSize + 1;
+                        node = node->right;
+                    }
+                }
+                return nullptr;
+            }
+
+            template <typename... ValueArgs>
+            Node * createNode(  ValueArgs &&... args    )
+            {
+                Node * node = NodeTraits::allocate(m_allocator, 1);
+                std::construct_at(node);
+                try
+                {
+                    NodeTraits::construct(m_allocator, std::addressof(node->value), std::forward<ValueArgs>(args)...);
+                }
+                catch(...)
+                {
+                    std::destroy_at(node);
+                    NodeTraits::deallocate(m_allocator, node, 1);
+                    throw;
+                }
+                //splitmix64 of a counter, so priorities are well spread without a random engine per map
+                std::uint64_t priority = (m_seed += 0x9E3779B97F4A7C15ULL);
+                priority = (priority ^ (priority >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                priority = (priority ^ (priority >> 27)) * 0x94D049BB133111EBULL;
+                node->priority = priority ^ (priority >> 31);
+                return node;
+            }
+
+            void destroyNode(   Node * node ) noexcept
+            {
+                NodeTraits::destroy(m_allocator, std::addressof(node->value));
+                std::destroy_at(node);
+                NodeTraits::deallocate(m_allocator, node, 1);
+            }
+
+            void destroySubtree(    Node * node ) noexcept
+            {
+                //Iteratively, so a degenerate tree can't overflow the stack
+                while(node != nullptr)
+                {
+                    if(node->left)
+                    {
+                        Node * left = node->left;
+                        node->left = nullptr;
+                        node = left;
+                    }
+                    else if(node->right)
+                    {
+                        Node * right = node->right;
+                        node->right = nullptr;
+                        node = right;
+                    }
+                    else
+                    {
+                        Node * parent = node->parent;
+                        destroyNode(node);
+                        node = parent;
+                    }
+                }
+            }
+
+            //Takes source's nodes, which must have come from an allocator equal to this map's
+            void adoptTree( OrderStatisticMap & source  ) noexcept
+            {
+                clear();
+                m_compare = std::move(source.m_compare);
+                m_root = std::exchange(source.m_root, nullptr);
+                m_seed = source.m_seed;
+            }
+
+            //Moves source's values into new nodes from this map's allocator, leaving source empty
+            void moveElementsFrom(  OrderStatisticMap & source  )
+            {
+                for(value_type & pair : source)
+                {
+                    emplace(pair.first, std::move(pair.second));
+                }
+                source.clear();
+            }
+
+            Node * clone(   const Node * source,
+                            Node * parent   )
+            {
+                if(source == nullptr)
+                {
+                    return nullptr;
+                }
+                Node * node = createNode(source->value);
+                node->priority = source->priority;
+                node->size = source->size;
+                node->parent = parent;
+                try
+                {
+                    node->left = clone(source->left, node);
+                    node->right = clone(source->right, node);
+                }
+                catch(...)
+                {
+                    destroySubtree(node);
+                    throw;
+                }
+                return node;
+            }
+
+            void replaceChild(  Node * parent,
+                                Node * child,
+                                Node * replacement  ) noexcept
+            {
+                if(parent == nullptr)
+                {
+                    m_root = replacement;
+                }
+                else if(parent->left == child)
+                {
+                    parent->left = replacement;
+                }
+                else
+                {
+                    parent->right = replacement;
+                }
+                if(replacement)
+                {
+                    replacement->parent = parent;
+                }
+            }
+
+            //Lifts node's child into node's place, keeping the search order and every subtree size correct
+            void rotateUp(  Node * child    ) noexcept
+            {
+                Node * node = child->parent;
+                replaceChild(node->parent, node, child);
+                if(node->left == child)
+                {
+                    node->left = child->right;
+                    if(child->right)
+                    {
+                        child->right->parent = node;
+                    }
+                    child->right = node;
+                }
+                else
+                {
+                    node->right = child->left;
+                    if(child->left)
+                    {
+                        child->left->parent = node;
+                    }
+                    child->left = node;
+                }
+                node->parent = child;
+                child->size = node->size;
+                node->size = 1 + sizeOf(node->left) + sizeOf(node->right);
+            }
+
+            std::pair<Node *, bool> insertNode( Node * node )
+            {
+                Node * parent = nullptr;
+                bool goLeft = false;
+                for(Node * current = m_root; current != nullptr; )
+                {
+                    parent = current;
+                    if(m_compare(node->value.first, current->value.first))
+                    {
+                        goLeft = true;
+                        current = current->left;
+                    }
+                    else if(m_compare(current->value.first, node->value.first))
+                    {
+                        goLeft = false;
+                        current = current->right;
+                    }
+                    else
+                    {
+                        return {current, false};
+                    }
+                }
+
+                node->parent = parent;
+                if(parent == nullptr)
+                {
+                    m_root = node;
+                }
+                else
+                {
+                    (goLeft ? parent->left : parent->right) = node;
+                }
+                for(Node * ancestor = parent; ancestor != nullptr; ancestor = ancestor->parent)
+                {
+                    ancestor->size++;
+                }
+                //Restore the heap order of the priorities
+                while(node->parent && node->parent->priority < node->priority)
+                {
+                    rotateUp(node);
+                }
+                return {node, true};
+            }
+
+            void eraseNode( Node * node ) noexcept
+            {
+                //Rotate node down below its higher priority child until it has at most one child, then splice it out
+                while(node->left && node->right)
+                {
+                    rotateUp(node->left->priority > node->right->priority ? node->left : node->right);
+                }
+                Node * parent = node->parent;
+                replaceChild(parent, node, node->left ? node->left : node->right);
+                for(Node * ancestor = parent; ancestor != nullptr; ancestor = ancestor->parent)
+                {
+                    ancestor->size--;
+                }
+                destroyNode(node);
+            }
+
+            [[no_unique_address]] Compare m_compare;
+            [[no_unique_address]] NodeAllocator m_allocator;
+            Node * m_root = nullptr;
+            std::uint64_t m_seed = 0;
+    };
+
+
+    /**
+     * @brief Gets a random key from an OrderStatisticMap in O(log n), by picking a random position and finding its key.
+     * 
+     * @throws std::invalid_argument if the map is empty.
+     */
+    template <typename K, typename V, typename Compare, typename Allocator>
+    K getRandomKey( const OrderStatisticMap<K,V,Compare,Allocator> & map    )
+    {
+        if(map.empty())
+        {
+            throw std::invalid_argument("stevensMapLib::getRandomKey() cannot get a random key from an empty map");
+        }
+        return map.nth(rand() % map.size())->first;
+    }
+
+
+    /**
+     * @brief Removes and returns a random pair from an OrderStatisticMap in O(log n).
+     * 
+     * @throws std::invalid_argument if the map is empty.
+     */
+    template <typename K, typename V, typename Compare, typename Allocator>
+    std::pair<K,V> popRandom(   OrderStatisticMap<K,V,Compare,Allocator> & map  )
+    {
+        if(map.empty())
+        {
+            throw std::invalid_argument("stevensMapLib::popRandom() cannot pop a random pair from an empty map");
+        }
+        auto it = map.nth(rand() % map.size());
+        std::pair<K,V> randomPair(it->first, std::move(it->second));
+        map.erase(it);
+        return randomPair;
+    }
+
+
+    /*** Value clamping ***/
+    namespace detail
+    {
+        template <typename V>
+        void checkClampBounds(  const V & lo,
+                                const V & hi,
+                                const char * functionName   )
+        {
+            if(hi < lo)
+            {
+                throw std::invalid_argument(std::string("stevensMapLib::") + functionName + "() needs lo to be no greater than hi");
+            }
+        }
+
+        //min and max of numbers compile to branchless instructions (e.g. minsd/maxsd or cmov), unlike std::clamp's comparisons
+        template <typename V>
+        constexpr V clampValue( V value,
+                                V lo,
+                                V hi    ) noexcept
+        {
+            return std::min(std::max(value, lo), hi);
+        }
+    }
+
+
+    /**
+     * @brief Given a maplike object with values of a numeric type, limits every value to the range [lo, hi], writing through
+     *        each value's reference without branching.
+     * 
+     * Example: stevensMapLib::clampValues(scores, 0.0, 1.0);
+     * 
+     * @param map The maplike object with numeric values to clamp.
+     * @param lo The least value to allow.
+     * @param hi The greatest value to allow.
+     * @throws std::invalid_argument if hi is less than lo.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    void clampValues(   M<K,V,Args...> & map,
+                        std::type_identity_t<V> lo,
+                        std::type_identity_t<V> hi  )
+    {
+        STEVENSMAPLIB_INSTRUMENT("clampValues");
+        STEVENSMAPLIB_RECORD_SCANNED(map.size());
+        detail::checkClampBounds(lo, hi, "clampValues");
+        for(auto & [key,value] : map)
+        {
+            value = detail::clampValue(value, lo, hi);
+        }
+    }
+
+
+    /**
+     * @brief The same as clampValues(map, lo, hi), but for values stored contiguously, such as a column of scores kept
+     *        apart from their keys. The loop has no branches or lookups, so compilers vectorize it.
+     */
+    template <typename V, std::size_t Extent>
+    void clampValues(   std::span<V, Extent> values,
+                        std::type_identity_t<V> lo,
+                        std::type_identity_t<V> hi  )
+    {
+        detail::checkClampBounds(lo, hi, "clampValues");
+        for(V & value : values)
+        {
+            value = detail::clampValue(value, lo, hi);
+        }
+    }
+
+
+    /**
+     * @brief The same as setNegativeValuesToZero(map), but for values stored contiguously. Vectorizes like
+     *        clampValues(std::span, lo, hi).
+     */
+    template <typename V, std::size_t Extent>
+    void setNegativeValuesToZero(   std::span<V, Extent> values )
+    {
+        for(V & value : values)
+        {
+            value = std::max(value, V(0));
+        }
+    }
+
+
+    namespace detail
+    {
+        /**
+         * @brief Whether R is a contiguous container of values, like std::vector<double> or std::array<int,N>, rather than a
+         *        maplike object, so it can be viewed as a std::span.
+         */
+        template <typename R>
+        constexpr bool isContiguousValues = std::ranges::contiguous_range<R> && std::ranges::sized_range<R> &&
+                                            !requires { typename std::remove_cvref_t<R>::mapped_type; };
+    }
+
+
+    /**
+     * @brief The same as clampValues(std::span, lo, hi), for a contiguous container such as a std::vector of values, which a
+     *        std::span parameter can't be deduced from.
+     * 
+     * Example: std::vector<double> scores = {-0.5, 0.25, 3.0};
+     *          stevensMapLib::clampValues(scores, 0.0, 1.0);   //{0.0, 0.25, 1.0}
+     */
+    template <typename R>
+    requires detail::isContiguousValues<R>
+    void clampValues(   R & values,
+                        std::ranges::range_value_t<R> lo,
+                        std::ranges::range_value_t<R> hi    )
+    {
+        stevensMapLib::clampValues(std::span(values), lo, hi);
+    }
+
+
+    /**
+     * @brief The same as setNegativeValuesToZero(std::span), for a contiguous container such as a std::vector of values.
+     */
+    template <typename R>
+    requires detail::isContiguousValues<R>
+    void setNegativeValuesToZero(   R & values  )
+    {
+        stevensMapLib::setNegativeValuesToZero(std::span(values));
+    }
+
+
+    /**
+     * @brief The same as clampValues(map, lo, hi), but clamps chunks of the map in parallel on policy's pool.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    void clampValues(   const ParallelPolicy & policy,
+                        M<K,V,Args...> & map,
+                        std::type_identity_t<V> lo,
+                        std::type_identity_t<V> hi  )
+    {
+        detail::checkClampBounds(lo, hi, "clampValues");
+        detail::parallelForEachEntry(policy, map, [lo, hi](auto & entry) { entry.second = detail::clampValue(entry.second, lo, hi); });
+    }
+
+
+    /**
+     * @brief The same as clampValues(std::span, lo, hi), but clamps slices of the values in parallel on policy's pool, each
+     *        slice vectorized.
+     */
+    template <typename V, std::size_t Extent>
+    void clampValues(   const ParallelPolicy & policy,
+                        std::span<V, Extent> values,
+                        std::type_identity_t<V> lo,
+                        std::type_identity_t<V> hi  )
+    {
+        detail::checkClampBounds(lo, hi, "clampValues");
+        policy.threadPool().parallelFor(0, values.size(), policy.grainFor(values.size()), [values, lo, hi](std::size_t begin, std::size_t end)
+        {
+            stevensMapLib::clampValues(values.subspan(begin, end - begin), lo, hi);
+        });
+    }
+
+
     /**
-     * Takes two maplike structures as input and performs the + operation on their shared keys. The resulting pairs
-     * are returned in a maplike object of the same type.
-     * 
-     * Parameters:
-     *  M<K,V> A - One of the maplike objects we are adding together.
-     *  M<K,V> B - The other maplike object we are adding to the first.
-     *  std::string addOperationTarget - The target of the + operator with this function. Possible values are:
-     *                                   ///"keys" - Only perform the + operation on keys
-     *                                   "values" - Only perform the + operation on the values
-     *                                   "keys and values" - Perform the + operation on both keys and values 
-     *  bool omitKeysNotShared - Boolean indicating whether or not we should omit the pairs from A and B that they do not share from the returned map.
-     * 
-     * Returns:
-    */
-    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    M<K,V> addMaps  (   M<K,V> A,
-                        M<K,V> B,
-                        std::string addOperationTarget = "keys and values",
-                        bool omitKeysNotShared = false )
+     * @brief The same as setNegativeValuesToZero(std::span), but clamps slices of the values in parallel on policy's pool.
+     */
+    template <typename V, std::size_t Extent>
+    void setNegativeValuesToZero(   const ParallelPolicy & policy,
+                                    std::span<V, Extent> values )
     {
-        M<K,V> AB = {};
+        policy.threadPool().parallelFor(0, values.size(), policy.grainFor(values.size()), [values](std::size_t begin, std::size_t end)
+        {
+            stevensMapLib::setNegativeValuesToZero(values.subspan(begin, end - begin));
+        });
+    }
 
-        //Iterate through the pairs of map A and see if any match the keys of of map B
-        for(const auto & [key,value] : A)
+
+    /**
+     * @brief The same as clampValues(policy, std::span, lo, hi), for a contiguous container such as a std::vector of values.
+     */
+    template <typename R>
+    requires detail::isContiguousValues<R>
+    void clampValues(   const ParallelPolicy & policy,
+                        R & values,
+                        std::ranges::range_value_t<R> lo,
+                        std::ranges::range_value_t<R> hi    )
+    {
+        stevensMapLib::clampValues(policy, std::span(values), lo, hi);
+    }
+
+
+    /**
+     * @brief The same as setNegativeValuesToZero(policy, std::span), for a contiguous container such as a std::vector of values.
+     */
+    template <typename R>
+    requires detail::isContiguousValues<R>
+    void setNegativeValuesToZero(   const ParallelPolicy & policy,
+                                    R & values  )
+    {
+        stevensMapLib::setNegativeValuesToZero(policy, std::span(values));
+    }
+
+
+    /*** Sparse vector algebra ***/
+    namespace detail
+    {
+        /**
+         * @brief Whether a map iterates its keys in the order of its key_comp(), so two of them can be merged in one pass.
+         */
+        template <typename Map>
+        constexpr bool hasKeyOrder = requires(const Map & map) { typename Map::key_compare; map.key_comp(); map.lower_bound(map.begin()->first); };
+
+        /**
+         * @brief Whether V{} is a right identity of op, i.e. op(a, V{}) == a, so keys only in the left map can be left alone.
+         */
+        template <typename Op>
+        constexpr bool hasZeroRightIdentity = false;
+        template <typename T>
+        constexpr bool hasZeroRightIdentity<std::plus<T>> = true;
+        template <typename T>
+        constexpr bool hasZeroRightIdentity<std::minus<T>> = true;
+
+        //Combines two sorted maps by walking both in key order, appending each result at the end of result
+        template <typename Map, typename Op>
+        void mergeCombine(  const Map & A,
+                            const Map & B,
+                            Op & op,
+                            bool omitKeysNotShared,
+                            Map & result    )
         {
-            //When we find a match, perform the + operation on the targeted indicated by the addOperationTarget parameter
-            if(B.contains(key))
+            using V = typename Map::mapped_type;
+            auto compare = A.key_comp();
+            auto a = A.begin();
+            auto b = B.begin();
+            while(a != A.end() && b != B.end())
             {
-                //Store the matched value in map AB, and keep track of the key in map B that was found as a match
-                if(addOperationTarget == "values")
+                if(compare(a->first, b->first))
                 {
-                    AB[key] = A[key] + B[key];
+                    if(!omitKeysNotShared)
+                    {
+                        result.emplace_hint(result.end(), a->first, op(a->second, V{}));
+                    }
+                    a++;
                 }
-                else //keys and values
+                else if(compare(b->first, a->first))
+                {
+                    if(!omitKeysNotShared)
+                    {
+                        result.emplace_hint(result.end(), b->first, op(V{}, b->second));
+                    }
+                    b++;
+                }
+                else
                 {
-                    AB[key + key] = A[key] + B[key];
+                    result.emplace_hint(result.end(), a->first, op(a->second, b->second));
+                    a++;
+                    b++;
                 }
             }
-            else
+            if(!omitKeysNotShared)
             {
-                if(!omitKeysNotShared)
+                for(; a != A.end(); a++)
                 {
-                    //If we do not find a match, check to see if we should omit the key that is not shared. If not, store it in map AB.
-                    AB[key] = value;
+                    result.emplace_hint(result.end(), a->first, op(a->second, V{}));
+                }
+                for(; b != B.end(); b++)
+                {
+                    result.emplace_hint(result.end(), b->first, op(V{}, b->second));
                 }
             }
         }
-        //If we're not omitting shared keys, add the keys from B that were not matched
-        if(!omitKeysNotShared)
+
+        //Combines two maps by probing each key of A in B, and then each key of B in A for the keys A doesn't have
+        template <typename Map, typename Op>
+        void hashJoinCombine(   const Map & A,
+                                const Map & B,
+                                Op & op,
+                                bool omitKeysNotShared,
+                                Map & result    )
         {
-            for(const auto & [key,value] : B)
+            using V = typename Map::mapped_type;
+            if constexpr(requires { result.reserve(std::size_t(0)); })
             {
-                if(!AB.contains(key))
+                result.reserve(omitKeysNotShared ? std::min(A.size(), B.size()) : A.size() + B.size());
+            }
+            for(const auto & [key,value] : A)
+            {
+                auto match = B.find(key);
+                if(match != B.end())
                 {
-                    AB[key] = value;
+                    result.emplace(key, op(value, match->second));
+                }
+                else if(!omitKeysNotShared)
+                {
+                    result.emplace(key, op(value, V{}));
+                }
+            }
+            if(!omitKeysNotShared)
+            {
+                for(const auto & [key,value] : B)
+                {
+                    if(!A.contains(key))
+                    {
+                        result.emplace(key, op(V{}, value));
+                    }
                 }
             }
         }
-
-        return AB;
     }
 
 
     /**
-     * @brief Given a map with values of a numeric type and a numeric factor, multiply each value in the map by the factor, setting the 
-     *        values for each pair to be equal to the product of the factor and the initial value.
-     * 
-     * @param map The maplike object we are multiplying the values of.
-     * @param factor The factor we are multiplying the values of the map by.
-     * 
-     * @return The map parameter but with all of its values multiplied by the factor parameter.
+     * @brief The same as combineMaps(A, B, op, omitKeysNotShared), but the returned map allocates through resultAllocator.
      */
-    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    M<K,V> multiplyWithValues(  M<K,V> map,
-                                long double factor)
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args, typename Op>
+    M<K,V,Args...> combineMaps( std::allocator_arg_t,
+                                const typename M<K,V,Args...>::allocator_type & resultAllocator,
+                                const M<K,V,Args...> & A,
+                                const M<K,V,Args...> & B,
+                                Op op,
+                                bool omitKeysNotShared = false  )
     {
-        //Iterate through the map, multipling each value by the factor and setting the value equal to the product
-        for(auto & [key,value] : map)
+        M<K,V,Args...> result = detail::emptyLike(A, resultAllocator);
+        if constexpr(detail::hasKeyOrder<M<K,V,Args...>>)
         {
-            value = value * factor;
+            detail::mergeCombine(A, B, op, omitKeysNotShared, result);
         }
-
-        return map;
+        else
+        {
+            detail::hashJoinCombine(A, B, op, omitKeysNotShared, result);
+        }
+        return result;
     }
 
 
     /**
-     * @brief Given a map with values of a numeric type and a numeric initial value, sum all of the values in the map with eachtother.
+     * @brief Treats two maps as sparse vectors and applies a binary operation to them key by key, the way addMaps(A, B, "values")
+     *        applies +. A key that's missing from one map stands for V{}, i.e. zero. Sorted maps are merged in one pass over
+     *        both, and hash maps are joined by probing one with the keys of the other.
      * 
-     * @param map The map containing numeric values that we want to sum together.
-     * @param initialValue The value we begin our sum from.
+     * Example: auto delta = stevensMapLib::combineMaps(today, yesterday, std::minus<>());
+     *          auto ratio = stevensMapLib::combineMaps(hits, requests, std::divides<>(), true);
      * 
-     * @return The sum of all values in the map added to the initial value
+     * @tparam Op A callable taking two values and returning a value, e.g. std::minus<>, std::multiplies<>.
+     * @param A The left operand of every operation.
+     * @param B The right operand of every operation.
+     * @param op The operation applied to the pair of values for each key.
+     * @param omitKeysNotShared Whether to keep only the keys both maps have (intersection), rather than the keys either has (union).
+     * @return A map of the same type as A and B, using A's allocator, holding op(A[key], B[key]) for each key.
      */
-    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    V sumAllValues( M<K,V> map,
-                    V initialValue = 0  )
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args, typename Op>
+    M<K,V,Args...> combineMaps( const M<K,V,Args...> & A,
+                                const M<K,V,Args...> & B,
+                                Op op,
+                                bool omitKeysNotShared = false  )
     {
-        V sum = initialValue;
+        return stevensMapLib::combineMaps(std::allocator_arg, A.get_allocator(), A, B, std::move(op), omitKeysNotShared);
+    }
 
-        for(const auto & [key, value] : map)
+
+    /**
+     * @brief The same as combineMaps(A, B, op, omitKeysNotShared), but stores the results in A instead of building a new map,
+     *        like A op= B. When op is std::plus or std::minus, keys only in A are unchanged by the operation, so only B's
+     *        keys are visited and A += B costs one lookup per key of B.
+     * 
+     * Example: stevensMapLib::combineInto(totals, batch, std::plus<>());
+     * 
+     * @param A The map to update, which is the left operand of every operation.
+     * @param B The right operand of every operation.
+     * @param op The operation applied to the pair of values for each key.
+     * @param omitKeysNotShared Whether to erase the keys of A that B doesn't have, rather than add the keys B has that A doesn't.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args, typename Op>
+    void combineInto(   M<K,V,Args...> & A,
+                        const M<K,V,Args...> & B,
+                        Op op,
+                        bool omitKeysNotShared = false  )
+    {
+        if(!omitKeysNotShared && detail::hasZeroRightIdentity<Op>)
         {
-            sum += value; 
+            for(const auto & [key,value] : B)
+            {
+                //A key new to A starts at V{}, which is exactly the missing operand
+                auto & accumulated = A.try_emplace(key).first->second;
+                accumulated = op(accumulated, value);
+            }
+        }
+        else if constexpr(detail::hasKeyOrder<M<K,V,Args...>>)
+        {
+            auto compare = A.key_comp();
+            auto a = A.begin();
+            auto b = B.begin();
+            while(a != A.end())
+            {
+                if(b == B.end() || compare(a->first, b->first))
+                {
+                    //A key only in A
+                    if(omitKeysNotShared)
+                    {
+                        a = A.erase(a);
+                        continue;
+                    }
+                    a->second = op(a->second, V{});
+                    a++;
+                }
+                else if(compare(b->first, a->first))
+                {
+                    //A key only in B goes just before a
+                    if(!omitKeysNotShared)
+                    {
+                        A.emplace_hint(a, b->first, op(V{}, b->second));
+                    }
+                    b++;
+                }
+                else
+                {
+                    a->second = op(a->second, b->second);
+                    a++;
+                    b++;
+                }
+            }
+            for(; b != B.end() && !omitKeysNotShared; b++)
+            {
+                A.emplace_hint(A.end(), b->first, op(V{}, b->second));
+            }
+        }
+        else
+        {
+            for(auto a = A.begin(); a != A.end(); )
+            {
+                auto match = B.find(a->first);
+                if(match != B.end())
+                {
+                    a->second = op(a->second, match->second);
+                }
+                else if(omitKeysNotShared)
+                {
+                    a = A.erase(a);
+                    continue;
+                }
+                else
+                {
+                    a->second = op(a->second, V{});
+                }
+                a++;
+            }
+            if(!omitKeysNotShared)
+            {
+                //Every key of B now in A was already in it, so only B's other keys are inserted
+                for(const auto & [key,value] : B)
+                {
+                    if(!A.contains(key))
+                    {
+                        A.emplace(key, op(V{}, value));
+                    }
+                }
+            }
         }
+    }
 
-        return sum;
+
+    /**
+     * @brief Subtracts the values of B from the values of A key by key, treating a missing value as zero.
+     *        The same as combineMaps(A, B, std::minus<>(), omitKeysNotShared).
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    M<K,V,Args...> subtractMaps(    const M<K,V,Args...> & A,
+                                    const M<K,V,Args...> & B,
+                                    bool omitKeysNotShared = false  )
+    {
+        return stevensMapLib::combineMaps(A, B, std::minus<>(), omitKeysNotShared);
     }
 
 
+    /**
+     * @brief Multiplies the values of A and B key by key. A key in only one map multiplies by zero, so by default only shared
+     *        keys are kept. The same as combineMaps(A, B, std::multiplies<>(), omitKeysNotShared).
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    M<K,V,Args...> multiplyMaps(    const M<K,V,Args...> & A,
+                                    const M<K,V,Args...> & B,
+                                    bool omitKeysNotShared = true   )
+    {
+        return stevensMapLib::combineMaps(A, B, std::multiplies<>(), omitKeysNotShared);
+    }
+
 
     /**
-     * Converts a maplike object with keys of type K and values of type V to a vector of tuples with the first index containing the key
-     * and the second index containing the value.
-     * 
-     * Parameter:
-     *  M<K,V> umap - The map that we want to convert to a vector of tuples.
-     * 
-     * Returns:
-     *  std::vector< tuple<K,V> > - A vector containing tuples of the key-value pairs from the passed-in map in no particular order.
-     * 
-    */
+     * @brief Divides the values of A by the values of B key by key. A key missing from B would divide by zero, so by default
+     *        only shared keys are kept. The same as combineMaps(A, B, std::divides<>(), omitKeysNotShared).
+     */
     template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    std::vector< std::tuple<K,V> > mapToVecOfTuples( M<K,V> map )
+    M<K,V,Args...> divideMaps(  const M<K,V,Args...> & A,
+                                const M<K,V,Args...> & B,
+                                bool omitKeysNotShared = true   )
     {
-        std::vector< std::tuple<K,V> > returnVec = {};
+        return stevensMapLib::combineMaps(A, B, std::divides<>(), omitKeysNotShared);
+    }
 
-        //Iterate through the unordered_map
-        for(const auto & [key,value] : map)
-        {
-            //Construct a tuple containing the key and the value and push it to the returnVec
-            returnVec.push_back( std::make_tuple(key,value) );
-        }
 
-        return returnVec;
+    /**
+     * @brief Takes the lesser of the values of A and B key by key, treating a missing value as zero.
+     */
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    M<K,V,Args...> minMaps( const M<K,V,Args...> & A,
+                            const M<K,V,Args...> & B,
+                            bool omitKeysNotShared = false  )
+    {
+        return stevensMapLib::combineMaps(A, B, [](const V & a, const V & b) { return std::min(a, b); }, omitKeysNotShared);
     }
 
 
     /**
-     * @brief Given a map with typing M<K,V>, return the map with all of its keys contained in a given vector erased.
-     * 
-     * @param map The map we want to erase keys from.
-     * @param keysToErase A vector of keys we want to erase from the map, if the map contains them.
-     * 
-     * @return The parameter map but with all of its keys contained within keysToErase erased from it.
+     * @brief Takes the greater of the values of A and B key by key, treating a missing value as zero.
      */
     template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    M<K,V> erase(   M<K,V> map, 
-                    const std::vector<K> & keysToErase)
+    M<K,V,Args...> maxMaps( const M<K,V,Args...> & A,
+                            const M<K,V,Args...> & B,
+                            bool omitKeysNotShared = false  )
     {
-        //For each key to erase, erase it from the map
-        for(int i = 0; i < keysToErase.size(); i++)
+        return stevensMapLib::combineMaps(A, B, [](const V & a, const V & b) { return std::max(a, b); }, omitKeysNotShared);
+    }
+
+
+    /*** Sparse similarity ***/
+    namespace detail
+    {
+        template <typename It>
+        constexpr bool isRandomAccess = std::random_access_iterator<It>;
+
+        /**
+         * @brief Whether looking up each of probes keys in a sorted map of tableSize keys, at about log2(tableSize) steps a
+         *        lookup, is cheaper than merging with the whole map.
+         */
+        inline bool probingIsCheaper(   std::size_t probes,
+                                        std::size_t tableSize   )
         {
-            map.erase(keysToErase[i]);
+            return probes * static_cast<std::size_t>(std::bit_width(tableSize)) < tableSize;
+        }
+
+        //Projects a pair onto its key without copying it
+        struct PairKey
+        {
+            template <typename Pair>
+            const auto & operator()(    const Pair & pair   ) const
+            {
+                return pair.first;
+            }
+        };
+
+        /**
+         * @brief Finds the first element of the sorted range [first, last) whose key is not less than key, by doubling a step
+         *        from first until it passes key and then binary searching the last step. Costs O(log d) for an answer d
+         *        elements from first, so walking a large range in short hops stays close to linear.
+         */
+        template <typename It, typename Key, typename Compare, typename Projection>
+        It gallopLowerBound(    It first,
+                                It last,
+                                const Key & key,
+                                Compare & compare,
+                                Projection projection   )
+        {
+            if(first == last || !compare(projection(*first), key))
+            {
+                return first;
+            }
+            //Everything up to and including low is less than key
+            It low = first;
+            std::ptrdiff_t step = 1;
+            while(step < last - low && compare(projection(low[step]), key))
+            {
+                low += step;
+                step *= 2;
+            }
+            It high = step < last - low ? low + step : last;
+            return std::ranges::lower_bound(low + 1, high, key, [&](const auto & element, const auto & target)
+            {
+                return compare(element, target);
+            }, projection);
+        }
+
+        //Calls visit(a, b) for each pair of iterators with equal keys from two ranges sorted by compare, galloping past runs of unshared keys
+        template <typename ItA, typename ItB, typename Compare, typename Visitor>
+        void gallopingMerge(    ItA a,
+                                ItA aEnd,
+                                ItB b,
+                                ItB bEnd,
+                                Compare compare,
+                                Visitor && visit    )
+        {
+            while(a != aEnd && b != bEnd)
+            {
+                if(compare(a->first, b->first))
+                {
+                    a = detail::gallopLowerBound(a, aEnd, b->first, compare, PairKey());
+                }
+                else if(compare(b->first, a->first))
+                {
+                    b = detail::gallopLowerBound(b, bEnd, a->first, compare, PairKey());
+                }
+                else
+                {
+                    visit(a, b);
+                    a++;
+                    b++;
+                }
+            }
+        }
+
+        /**
+         * @brief Calls visit(a, b) with an iterator into A and one into B for every key the two maps share, in key order when the
+         *        maps are sorted. Picks the cheapest way to find the shared keys for the kind of map:
+         *        - sorted with random-access iterators: a galloping merge, linear for similar sizes and logarithmic per key of the
+         *          smaller map for very different sizes;
+         *        - sorted otherwise: a linear merge, or a lookup in the larger map for each key of the smaller when that's cheaper;
+         *        - hashed: a lookup in the larger map for each key of the smaller.
+         */
+        template <typename Map, typename Visitor>
+        void forEachSharedKey(  const Map & A,
+                                const Map & B,
+                                Visitor && visit    )
+        {
+            if constexpr(hasKeyOrder<Map> && isRandomAccess<typename Map::const_iterator>)
+            {
+                detail::gallopingMerge(A.begin(), A.end(), B.begin(), B.end(), A.key_comp(), visit);
+            }
+            else
+            {
+                const Map & smaller = A.size() <= B.size() ? A : B;
+                const Map & larger = A.size() <= B.size() ? B : A;
+                bool probe = true;
+                if constexpr(hasKeyOrder<Map>)
+                {
+                    probe = detail::probingIsCheaper(smaller.size(), larger.size());
+                }
+                if(probe)
+                {
+                    for(auto it = smaller.begin(); it != smaller.end(); it++)
+                    {
+                        auto match = larger.find(it->first);
+                        if(match != larger.end())
+                        {
+                            if(&smaller == &A)
+                            {
+                                visit(it, match);
+                            }
+                            else
+                            {
+                                visit(match, it);
+                            }
+                        }
+                    }
+                }
+                else if constexpr(hasKeyOrder<Map>)
+                {
+                    auto compare = A.key_comp();
+                    auto a = A.begin();
+                    auto b = B.begin();
+                    while(a != A.end() && b != B.end())
+                    {
+                        if(compare(a->first, b->first))
+                        {
+                            a++;
+                        }
+                        else if(compare(b->first, a->first))
+                        {
+                            b++;
+                        }
+                        else
+                        {
+                            visit(a, b);
+                            a++;
+                            b++;
+                        }
+                    }
+                }
+            }
+        }
+
+        //Adds a[i] * b[j] over the indices where keyA(i) == keyB(j), for sorted integer keys read through keyA and keyB
+        template <typename V, typename KeyA, typename KeyB>
+        V branchlessSortedDot(  std::size_t aCount,
+                                KeyA keyA,
+                                const V * aValues,
+                                std::size_t bCount,
+                                KeyB keyB,
+                                const V * bValues   )
+        {
+            V sum = 0;
+            std::size_t i = 0;
+            std::size_t j = 0;
+            //Every pair of keys steps one or both sides, so no branch depends on how the keys compare
+            while(i < aCount && j < bCount)
+            {
+                auto a = keyA(i);
+                auto b = keyB(j);
+                //Multiplying only matching values keeps signed integer values from overflowing on pairs that don't count;
+                //a multiply can't trap in hardware, so the compiler is still free to compute it unconditionally and select
+                sum += a == b ? aValues[i] * bValues[j] : V(0);
+                i += a <= b;
+                j += b <= a;
+            }
+            return sum;
         }
-        return map;
     }
 
 
+#if __has_include(<sys/mman.h>)
     /**
-     * @brief Gets a random key from a maplike object
-     * 
-     * @tparam M The maplike type that we are getting a key from.
-     * @tparam K The key type we are getting.
-     * @tparam V The value of the pairs in the maplike type we are getting a key from.
-     * 
-     * @param map - The map object we are picking a random key from.
-     * 
-     * @return A random key found in map.
+     * @brief The dot product of two MappedMapViews. Integer keys take a branchless merge over the key and value arrays in the
+     *        mapped files, or a galloping search when one view is much smaller; other keys take a galloping merge.
      */
-    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    K getRandomKey( const M<K,V> & map )
+    template <typename K, typename V>
+    V dot(  const MappedMapView<K,V> & A,
+            const MappedMapView<K,V> & B    )
     {
-        if(map.size() == 0)
+        V sum = 0;
+        std::size_t aCount = A.size();
+        std::size_t bCount = B.size();
+        bool similarSizes = !detail::probingIsCheaper(std::min(aCount, bCount), std::max(aCount, bCount));
+        if constexpr(std::is_integral_v<K>)
         {
-            throw std::invalid_argument("stevensMapLib::getRandomKey() cannot get a random key from an empty map");
+            if(similarSizes)
+            {
+                std::size_t aFirst = A.begin().index();
+                std::size_t bFirst = B.begin().index();
+                return detail::branchlessSortedDot( aCount, [&](std::size_t i) { return A.keyAt(aFirst + i); }, A.values().data(),
+                                                    bCount, [&](std::size_t j) { return B.keyAt(bFirst + j); }, B.values().data()  );
+            }
         }
-        auto it = map.begin();
-        long long int advanceAmount = rand() % map.size();
-        std::advance( it, advanceAmount );
-        return it->first;
+        detail::gallopingMerge(A.begin(), A.end(), B.begin(), B.end(), A.key_comp(), [&](auto a, auto b)
+        {
+            sum += A.valueAt(a.index()) * B.valueAt(b.index());
+        });
+        return sum;
     }
 
 
     /**
-     * @brief Gets a random value from a maplike object
-     * 
-     * @tparam M the maplike type we are getting a value from.
-     * @tparam K the type of key in the maplike type we are getting a value from.
-     * @tparam V the type of value we are getting.
-     * 
-     * @param map The map object we are picking a random value from.
-     * 
-     * @return A random value found in map.
+     * @brief The Euclidean norm of a MappedMapView, read straight from the contiguous values in the mapped file.
      */
-    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    V getRandomValue( const M<K,V> & map )
+    template <typename K, typename V>
+    double norm(    const MappedMapView<K,V> & map  )
     {
-        if(map.size() == 0)
+        double sumOfSquares = 0;
+        for(const V & value : map.values())
         {
-            throw std::invalid_argument("stevensMapLib::getRandomValue() cannot get a random value from an empty map");
+            sumOfSquares += static_cast<double>(value) * static_cast<double>(value);
         }
-        return map.at(stevensMapLib::getRandomKey(map));
+        return std::sqrt(sumOfSquares);
     }
 
 
+    //A MappedMapView is sorted by key_comp() with random-access iterators, so the generic merges take their galloping paths for it
+    static_assert(detail::hasKeyOrder< MappedMapView<int,double> > && detail::isRandomAccess< MappedMapView<int,double>::const_iterator >);
+    static_assert(detail::hasKeyOrder< MappedMapView<std::string_view,double> >);
+#endif
+
+
     /**
-     * @brief Returns the first key in the maplike object.
-     * 
-     * @tparam M The maplike type that we are getting a key from.
-     * @tparam K The key type we are getting.
-     * @tparam V The value of the pairs in the maplike type we are getting a key from.
+     * @brief The dot product of two maps treated as sparse vectors: the sum of A[key] * B[key] over the keys both maps have.
+     *        Only shared keys are visited. Sorted maps with random-access iterators are merged with a galloping search, other
+     *        sorted maps are merged or probed, and hash maps are joined by looking up each key of the smaller map in the larger.
      * 
-     * @param map - The map object we are getting the first key from.
+     * Example: double score = stevensMapLib::dot(queryFeatures, documentFeatures);
      * 
-     * @return The first key from the map.
+     * @param A A map with numeric values.
+     * @param B Another map of the same type.
+     * @return The sum of the products of the values of each shared key, or 0 if no key is shared.
      */
     template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    K getFirstKey( const M<K,V> & map)
+    V dot(  const M<K,V,Args...> & A,
+            const M<K,V,Args...> & B    )
     {
-        auto it = map.begin();
-        return it->first;
+        STEVENSMAPLIB_INSTRUMENT("dot");
+        V sum = 0;
+        detail::forEachSharedKey(A, B, [&](auto a, auto b)
+        {
+            sum += a->second * b->second;
+        });
+        return sum;
     }
 
 
     /**
-     * @brief Gets a vector containing all of the keys from each pair within the given map.
+     * @brief The Euclidean norm of a map treated as a sparse vector: the square root of the sum of its squared values.
      * 
-     * @tparam M The type of the maplike object we are obtaining keys from.
-     * @tparam K The type of the keys in the map.
-     * @tparam V The type of the values in the map.
-     * @tparam Args 
-     * @param map - The maplike object we are obtaining keys from.
-     * @return std::vector<K> - A vector containing all of the keys found in order from the maplike object.
+     * @param map A map with numeric values.
+     * @return The norm of map, as a double.
      */
     template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    std::vector<K> getKeyVector(    const M<K,V> & map  )
+    double norm(    const M<K,V,Args...> & map  )
     {
-        //Initialize a vector that we will push keys back into
-        std::vector<K> keyVector;
+        STEVENSMAPLIB_INSTRUMENT("norm");
+        STEVENSMAPLIB_RECORD_SCANNED(map.size());
+        double sumOfSquares = 0;
         for(const auto & [key,value] : map)
         {
-            keyVector.push_back(key);
+            sumOfSquares += static_cast<double>(value) * static_cast<double>(value);
         }
-        return keyVector;
+        return std::sqrt(sumOfSquares);
     }
 
 
     /**
-     * @brief Gets a vector containing all of the values from each pair within the given map.
+     * @brief The cosine similarity of two maps treated as sparse vectors: dot(A, B) / (norm(A) * norm(B)). Since cosine is
+     *        undefined for a zero vector, 0 is returned when either map has no nonzero value.
      * 
-     * @tparam M The type of maplike object we are obtaining values from.
-     * @tparam K The type of keys in the map.
-     * @tparam V THe type of values in the map.
-     * @tparam Args
-     * @param map - THe maplike object we are obtaining values from.
-     * @return std::vector<V> - A vector containing all of the values found in order from the maplike object.
+     * Example: double similarity = stevensMapLib::cosine(queryFeatures, documentFeatures);
+     * 
+     * @param A A map with numeric values.
+     * @param B Another map of the same type.
+     * @return The cosine of the angle between A and B, from -1 to 1.
      */
     template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    std::vector<V> getValueVector(  const M<K,V> & map )
+    double cosine(  const M<K,V,Args...> & A,
+                    const M<K,V,Args...> & B    )
     {
-        //Initialize a vector that we will push values back into
-        std::vector<V> valueVector;
-        for(const auto & [key,value] : map)
+        double normProduct = stevensMapLib::norm(A) * stevensMapLib::norm(B);
+        if(normProduct == 0)
         {
-            valueVector.push_back(value);
+            return 0;
         }
-        return valueVector;
+        return static_cast<double>(stevensMapLib::dot(A, B)) / normProduct;
     }
 
 
-    /**
-     * @brief Returns a maplike object which uses stringlike keys that begin only with a certain combination of characters.
-     * 
-     * Example: resultMap = stevensMapLib::getPairsWhereKeysStartWith("style:", { {"style:textColor","red"}, {"style:backgroundColor", "black"}, {"sectionName", "header"} });
-     * //resultMap == { {"style:textColor", "red"}, {"style:backgroundColor", "black"}  };
-     * 
-     * @tparam M The type of the maplike object we are getting pairs from.
-     * @tparam K The type of keys in the map. Must be stringlike. 
-     * @tparam V The type of values in the map.
-     * @tparam Args
-     * @param str - Stringlike string of characters we want all of our keys in our resulting map to start with, which are also contained within map
-     * @param map - The maplike object we are extracting key-value pairs from, which the keys must begin with str
-     * 
-     * @return M<K,V> A maplike object with stringlike keys which contains only keys that start with the requested string of characters.
-     */
-    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    M<K,V> getPairsWhereKeysStartWith(  const M<K,V> & map,
-                                        const K & str   )
+    /*** Key set operations ***/
+    namespace detail
     {
-        //This is the map that we'll return
-        M<K,V> returnMap = {};
+        /**
+         * @brief Walks two maps sorted by the same key_comp() together, calling onlyA(first, last) and onlyB(first, last) for
+         *        each run of keys only one map has and both(a, b) for each shared key. With random-access iterators a run is
+         *        skipped with a galloping search, so a short map is walked against a long one in O(short * log long).
+         */
+        template <typename Map, typename OnlyA, typename Both, typename OnlyB>
+        void sortedKeyWalk( const Map & A,
+                            const Map & B,
+                            OnlyA && onlyA,
+                            Both && both,
+                            OnlyB && onlyB  )
+        {
+            auto compare = A.key_comp();
+            auto skipBelow = [&](auto first, auto last, const auto & key)
+            {
+                if constexpr(isRandomAccess<typename Map::const_iterator>)
+                {
+                    return detail::gallopLowerBound(first, last, key, compare, PairKey());
+                }
+                else
+                {
+                    return std::next(first);
+                }
+            };
+            auto a = A.begin();
+            auto b = B.begin();
+            while(a != A.end() && b != B.end())
+            {
+                if(compare(a->first, b->first))
+                {
+                    auto next = skipBelow(a, A.end(), b->first);
+                    onlyA(a, next);
+                    a = next;
+                }
+                else if(compare(b->first, a->first))
+                {
+                    auto next = skipBelow(b, B.end(), a->first);
+                    onlyB(b, next);
+                    b = next;
+                }
+                else
+                {
+                    both(a, b);
+                    a++;
+                    b++;
+                }
+            }
+            onlyA(a, A.end());
+            onlyB(b, B.end());
+        }
 
-        //Iterate through all the keys in the map
-        for(const auto & [key,value] : map)
+        /**
+         * @brief Calls visit(a) with an iterator to each pair of A whose key B doesn't have. Sorted maps are walked together
+         *        unless looking up A's keys in B is cheaper; hash maps look up each key of A in B.
+         */
+        template <typename Map, typename Visitor>
+        void forEachKeyNotIn(   const Map & A,
+                                const Map & B,
+                                Visitor && visit    )
         {
-            //Add the pair that starts with str to the map that will be returned
-            if(stevensStringLib::startsWith(key, str))
+            if constexpr(hasKeyOrder<Map>)
             {
-                returnMap.emplace(key, value);
+                if(isRandomAccess<typename Map::const_iterator> || !detail::probingIsCheaper(A.size(), B.size()))
+                {
+                    auto emitRun = [&](auto first, auto last)
+                    {
+                        for(; first != last; first++)
+                        {
+                            visit(first);
+                        }
+                    };
+                    detail::sortedKeyWalk(A, B, emitRun, [](auto, auto) {}, [](auto, auto) {});
+                    return;
+                }
+            }
+            for(auto a = A.begin(); a != A.end(); a++)
+            {
+                if(B.find(a->first) == B.end())
+                {
+                    visit(a);
+                }
             }
         }
-        //Return the map with pairs that have only keys beginning with str
-        return returnMap;
+
+        /**
+         * @brief Calls visit(it) with an iterator to each pair of the union of A and B, taking a shared key's pair from A. Sorted
+         *        maps are merged so the pairs come in key order.
+         */
+        template <typename Map, typename Visitor>
+        void forEachKeyInEither(    const Map & A,
+                                    const Map & B,
+                                    Visitor && visit    )
+        {
+            auto emitRun = [&](auto first, auto last)
+            {
+                for(; first != last; first++)
+                {
+                    visit(first);
+                }
+            };
+            if constexpr(hasKeyOrder<Map>)
+            {
+                detail::sortedKeyWalk(A, B, emitRun, [&](auto a, auto) { visit(a); }, emitRun);
+            }
+            else
+            {
+                emitRun(A.begin(), A.end());
+                detail::forEachKeyNotIn(B, A, visit);
+            }
+        }
+
+        enum class KeySetOperation
+        {
+            Intersection,
+            Union,
+            Difference
+        };
+
+        /**
+         * @brief Combines the key sets of two expressions, taking each value from A, or from B for a key only B has. When both
+         *        operands are maps of the same type, intersections and differences are visited with the galloping kernels.
+         */
+        template <typename A, typename B, KeySetOperation Operation>
+        requires canLookUp<A> && canLookUp<B>
+        struct LazyKeySetNode
+        {
+            using key_type = typename A::key_type;
+            using mapped_type = typename A::mapped_type;
+
+            template <typename F>
+            void forEach(   F && visitor    ) const
+            {
+                if constexpr(Operation == KeySetOperation::Union)
+                {
+                    a.forEach(visitor);
+                    b.forEach([&](const key_type & key, const mapped_type & value)
+                    {
+                        if(!a.lookup(key))
+                        {
+                            visitor(key, value);
+                        }
+                    });
+                }
+                else if constexpr(std::is_same_v<A, B> && requires(const A & node) { node.map; })
+                {
+                    auto visitA = [&](auto it, auto...) { visitor(it->first, it->second); };
+                    if constexpr(Operation == KeySetOperation::Intersection)
+                    {
+                        detail::forEachSharedKey(*a.map, *b.map, visitA);
+                    }
+                    else
+                    {
+                        detail::forEachKeyNotIn(*a.map, *b.map, visitA);
+                    }
+                }
+                else
+                {
+                    a.forEach([&](const key_type & key, const mapped_type & value)
+                    {
+                        if(b.lookup(key).has_value() == (Operation == KeySetOperation::Intersection))
+                        {
+                            visitor(key, value);
+                        }
+                    });
+                }
+            }
+
+            std::optional<mapped_type> lookup(  const key_type & key    ) const
+            {
+                std::optional<mapped_type> value = a.lookup(key);
+                if constexpr(Operation == KeySetOperation::Union)
+                {
+                    return value ? value : b.lookup(key);
+                }
+                else
+                {
+                    return value && b.lookup(key).has_value() == (Operation == KeySetOperation::Intersection) ? value : std::nullopt;
+                }
+            }
+
+            A a;
+            B b;
+        };
+
+        template <KeySetOperation Operation, typename A, typename B>
+        auto lazyKeySet(    A && mapA,
+                            B && mapB   )
+        {
+            using NodeA = decltype(detail::toLazyNode(std::forward<A>(mapA)));
+            using NodeB = decltype(detail::toLazyNode(std::forward<B>(mapB)));
+            return lazy::MapExpression< LazyKeySetNode<NodeA,NodeB,Operation> >({ detail::toLazyNode(std::forward<A>(mapA)), detail::toLazyNode(std::forward<B>(mapB)) });
+        }
     }
 
 
     /**
-     * @brief Modifies a maplike object's stringlike keys by erasing all instances of a substring from the keys.
+     * @brief Gets the keys two maps share, the way addMaps() finds the keys it adds when omitKeysNotShared is true, but
+     *        without visiting every key of the larger map. Sorted maps with random-access iterators, such as MappedMapView,
+     *        switch between a linear merge and a galloping search on their own as the sizes of the maps diverge; other sorted
+     *        maps merge or look up the keys of the smaller map in the larger, whichever is cheaper; hash maps always look up the
+     *        keys of the smaller map.
      * 
-     * Example: resultMap = stevensMapLib::eraseStringFromKeys( "style:",   {   {"style:textColor", "red"}, {"style:backgroundColor", "black"}  });
-     * //resultMap == { {"textColor", "red"},   {"backgroundColor", "black"}};
+     * Example: auto shared = stevensMapLib::keyIntersection(hundredKeys, tenMillionKeys); //About 100 lookups
      * 
-     * @tparam M The type of maplike object we are modifying the keys of.
-     * @tparam K The type of keys in the map.
-     * @param str The string we wish to target and erase from all of map's keys.
-     * @param map The maplike object with stringlike keys we are modifying the keys of.
-     * @return M<K,V> A modified version of the map we passed into the function, with all of its keys having str erased from them.
+     * @param A A map.
+     * @param B Another map of the same type.
+     * @return The keys both maps have, in key order for sorted maps.
      */
     template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    M<K,V> eraseStringFromKeys( const M<K,V> & map,
-                                const K & str   )
+    std::vector<K> keyIntersection( const M<K,V,Args...> & A,
+                                    const M<K,V,Args...> & B    )
     {
-        //The map that will be returned
-        M<K,V> returnMap = {};
-        //Variable that will hold the modified key
-        K modifiedKey;
-
-        //Iterate through all the keys in the map
-        for(const auto & [key,value] : map)
+        STEVENSMAPLIB_INSTRUMENT("keyIntersection");
+        std::vector<K> keys;
+        keys.reserve(std::min(A.size(), B.size()));
+        detail::forEachSharedKey(A, B, [&](auto a, auto)
         {
-            //We remove the str from the key's name and add it to our return map
-            modifiedKey = stevensStringLib::replaceSubstr(key, str, "");
-            returnMap.emplace(modifiedKey, value);
-        }
-
-        return returnMap;
+            keys.push_back(a->first);
+        });
+        return keys;
     }
 
 
     /**
-     * @brief Given a maplike object with values of a numeric tyoe, return the map with all of its elements that have 
-     *        values less than zero set to zero.
-     * 
-     * Example:
-     * setNegativeValuesTOZero( {{"firstKey", 3}, {"secondKey", -9001}, {"thirdKey", -4}} ) == { {"firstKey",3}, {"secondKey",0}, {"thirdKey",0} };
+     * @brief Gets the keys either of two maps has, each once. Sorted maps are merged, and hash maps add the keys of B that A
+     *        doesn't have to the keys of A.
      * 
-     * @param map - The maplike object with numeric values (bool, short, int, long, float, double, etc) that we want its negative values set to zero.
-     * @return Void, but directly modifies the map object we pass in by reference.
+     * @param A A map.
+     * @param B Another map of the same type.
+     * @return The keys of A and B, in key order for sorted maps.
      */
-    template<typename M>
-    void setNegativeValuesToZero( M & map )
+    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
+    std::vector<K> keyUnion(    const M<K,V,Args...> & A,
+                                const M<K,V,Args...> & B    )
     {
-        for(auto & [key,value] : map)
+        STEVENSMAPLIB_INSTRUMENT("keyUnion");
+        std::vector<K> keys;
+        keys.reserve(std::max(A.size(), B.size()));
+        detail::forEachKeyInEither(A, B, [&](auto it)
         {
-            if(value < 0)
-            {
-                map[key] = 0;
-            }
-        }
+            keys.push_back(it->first);
+        });
+        return keys;
     }
 
 
     /**
-     * @brief Given a maplike object that uses stringlike keys and a prospective key for the map, modify the key so that it
-     *        it is unique from anything else in map. Useful for creating new, valid keys for maps.
-     * 
-     * @tparam M The type of maplike object object we are creating a unique key for.
-     * @tparam K The stringlike type of key we are creating a unique instance of for the map.
-     * @tparam V The type of value in the maplike object map.
-     * @tparam Args
-     * @param map The maplike object we are creating a unique key for.
-     * @param keyString The stringlike key we are potentially modifying to be unique relative to all other keys in map.
-     * @param algorithm The method by which we modify our key to make it unique.
+     * @brief Gets the keys of A that B doesn't have. For sorted maps with random-access iterators, runs of keys of A are found
+     *        by galloping through B, so a small A costs O(|A| log |B|) against a large B.
      * 
+     * @param A The map whose keys are kept.
+     * @param B The map whose keys are removed from A's.
+     * @return The keys of A not in B, in key order for sorted maps.
      */
     template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    K createUniqueKeyString(    const M<K,V> & map,
-                                K keyString = "",
-                                const std::string & algorithm = "integer concatenation"    )
+    std::vector<K> keyDifference(   const M<K,V,Args...> & A,
+                                    const M<K,V,Args...> & B    )
     {
-        if(algorithm == "integer concatenation")
+        STEVENSMAPLIB_INSTRUMENT("keyDifference");
+        std::vector<K> keys;
+        detail::forEachKeyNotIn(A, B, [&](auto a)
         {
-            K originalKeyString = keyString;
-            int integerSuffix = 0;
-            while(map.contains(keyString))
-            {
-                keyString = originalKeyString + std::to_string(integerSuffix);
-                integerSuffix++;
-            }
-        }
-
-        return keyString;
+            keys.push_back(a->first);
+        });
+        return keys;
     }
 
 
     /**
-     * @brief Given a maplike object, return a random key-value pair from the map, deleting it from the map in the process.
-     * 
-     * @tparam M The type of the maplike object we are popping a pair from.
-     * @tparam K The type of key in the pair we are popping from the map.
-     * @tparam V The type of value in the pair we are popping from the map.
-     * @tparam Args
-     * @param map The maplike object we are popping a key-value pair from.
-     * @return A random pair from the map
-     * 
+     * @brief The same as keyIntersection(A, B), but returns the pairs of A whose keys B has, in a map of the same type as A.
      */
     template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    std::pair<K,V> popRandom(   M<K,V> & map    )
+    M<K,V,Args...> pairIntersection(    const M<K,V,Args...> & A,
+                                        const M<K,V,Args...> & B    )
     {
-        //Can't pop a key if the map is empty
-        if(map.size() == 0)
+        M<K,V,Args...> result = detail::emptyLike(A, A.get_allocator());
+        detail::forEachSharedKey(A, B, [&](auto a, auto)
         {
-            throw std::invalid_argument("stevensMapLib::popRandom() cannot pop a random pair from an empty map");
-        }
-
-        //Get a random pair from the map using getRandomKey()
-        K key = stevensMapLib::getRandomKey(map);
-        V value = map[key];
-        //Construct the pair we want to return
-        std::pair<K,V> randomPair = std::pair(key, value);
-        //Erase the pair from the source map
-        map.erase(key);
-        return randomPair;
+            result.emplace_hint(result.end(), a->first, a->second);
+        });
+        return result;
     }
 
 
     /**
-     * @brief Given a maplike object map, insert a range of integers as string keys within the map.
-     * 
-     * @tparam M The type of the maplike object map.
-     * @tparam K The keys belonging to the maplike object map.
-     * @tparam V The values belonging to the maplike object map.
-     * @tparam Args
-     * @param map The maplike object we are inserting an integer range of keys into.
-     * @param rangeStart The first number to insert as a key into the map.
-     * @param rangeEnd The last number to insert as a key into the map.
+     * @brief The same as keyUnion(A, B), but returns the pairs of both maps in a map of the same type as A. A key both maps
+     *        have keeps its value from A.
      */
     template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    void insertNumericRangeAsStringKeys(    M<K,V> & map,
-                                            const long long int & rangeStart,
-                                            const long long int & rangeEnd  )
+    M<K,V,Args...> pairUnion(   const M<K,V,Args...> & A,
+                                const M<K,V,Args...> & B    )
     {
-        //Insert every number in the range as a string key
-        for(int i = rangeStart; i <= rangeEnd; i++)
+        M<K,V,Args...> result = detail::emptyLike(A, A.get_allocator());
+        detail::forEachKeyInEither(A, B, [&](auto it)
         {
-            map[std::to_string(i)];
-        }
+            result.emplace_hint(result.end(), it->first, it->second);
+        });
+        return result;
     }
 
 
     /**
-     * @brief Given a maplike object with a numeric-type as its values, return the key-value pair from the
-     *        maplike object with the greatest value. If more than one pair has the greatest value, we will return
-     *        the pair that comes earliest in iterating through the pairs.
-     * 
-     * @param map The maplike object with numeric values which we are obtaining pair with the greatest value.
-     * @return A std::pair<K,V> object from map containing the greatest value from all existing pairs in the map.
+     * @brief The same as keyDifference(A, B), but returns the pairs of A whose keys B doesn't have, in a map of the same type as A.
      */
     template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    std::pair<K,V> getPairWithMaxValue( const M<K,V> & map  )
+    M<K,V,Args...> pairDifference(  const M<K,V,Args...> & A,
+                                    const M<K,V,Args...> & B    )
     {
-        //Check to see if the map is empty; we can't get a pair from an empty map
-        if(map.empty())
+        M<K,V,Args...> result = detail::emptyLike(A, A.get_allocator());
+        detail::forEachKeyNotIn(A, B, [&](auto a)
         {
-            throw std::invalid_argument("stevensMapLib::getPairWithMaxValue() cannot get a pair from an empty map");
+            result.emplace_hint(result.end(), a->first, a->second);
+        });
+        return result;
+    }
+
+
+    namespace lazy
+    {
+        /**
+         * @brief Lazily keeps the pairs of A whose keys B has, like stevensMapLib::pairIntersection(). Visiting the expression
+         *        uses the galloping kernels when A and B are maps of the same type.
+         * 
+         * Example: double sharedTotal = stevensMapLib::sumAllValues(lazy::keyIntersection(A, B));
+         */
+        template <typename A, typename B>
+        auto keyIntersection(   A && mapA,
+                                B && mapB   )
+        {
+            return detail::lazyKeySet<detail::KeySetOperation::Intersection>(std::forward<A>(mapA), std::forward<B>(mapB));
         }
 
-        //Establish the key and value of the max pair
-        K maxKey = stevensMapLib::getFirstKey(map);
-        V maxValue = map.at(maxKey);
-        //Iterate through all of the the key-value pairs in the map
-        for(const auto & [key,value] : map)
+
+        /**
+         * @brief Lazily combines the pairs of A and B, keeping A's value for a shared key, like stevensMapLib::pairUnion().
+         */
+        template <typename A, typename B>
+        auto keyUnion(  A && mapA,
+                        B && mapB   )
         {
-            //If we find a value greater than the max value, set the max value to the value of the current pair's value
-            if(value > maxValue)
-            {
-                maxValue = value;
-                maxKey = key;
-            }
+            return detail::lazyKeySet<detail::KeySetOperation::Union>(std::forward<A>(mapA), std::forward<B>(mapB));
         }
 
-        //Reconstruct the pair we found containing the max value from the map
-        std::pair<K,V> maxPair = std::pair(maxKey, maxValue); 
-        return maxPair;
+
+        /**
+         * @brief Lazily keeps the pairs of A whose keys B doesn't have, like stevensMapLib::pairDifference().
+         */
+        template <typename A, typename B>
+        auto keyDifference( A && mapA,
+                            B && mapB   )
+        {
+            return detail::lazyKeySet<detail::KeySetOperation::Difference>(std::forward<A>(mapA), std::forward<B>(mapB));
+        }
     }
 
 
-    /**
-     * @brief Given a maplike object with a numeric type object for its keys (or a type that can be compared with > < operators),
-     *        return the key-value pair from the maplike object with the greatest key.
-     * 
-     * @param map The maplike object with a comparable type for keys which we are obtaining the pair with the greatest key.
-     * @return A std::pair<K,V> object from map containing the greatest key from all pairs existing in the map.
-     */
-    template <template <typename, typename, typename...> class M, typename K, typename V, typename... Args>
-    std::pair<K,V> getPairWithMaxKey(   const M<K,V> & map  )
+};
+#endif
+
+//Define STEVENSMAPLIB_COUNT_ALLOCATIONS_IMPLEMENTATION in exactly one source file, before including this header, to replace the
+//global operator new and delete with versions that count each thread's allocations for instrumentation::measureAllocations().
+#if defined(STEVENSMAPLIB_COUNT_ALLOCATIONS_IMPLEMENTATION) && !defined(STEVENSMAPLIB_COUNT_ALLOCATIONS_IMPLEMENTED)
+#define STEVENSMAPLIB_COUNT_ALLOCATIONS_IMPLEMENTED
+
+namespace stevensMapLib::instrumentation::detail
+{
+    inline void * rawAllocate(  std::size_t size,
+                                std::size_t alignment   ) noexcept
     {
-        //Check to see if the map is empty; we can't get a pair from an empty map
-        if(map.empty())
+        if(size == 0)
         {
-            throw std::invalid_argument("stevensMapLib::getPairWithMaxKey() cannot get a pair from an empty map");
+            size = 1;
         }
+        if(alignment <= alignof(std::max_align_t))
+        {
+            return std::malloc(size);
+        }
+        //aligned_alloc requires the size to be a multiple of the alignment
+        return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    }
 
-        //Establish the key and value of the max pair
-        K maxKey = stevensMapLib::getFirstKey(map);
-        V maxValue = map.at(maxKey);
-        //Iterate through all of the the key-value pairs in the map
-        for(const auto & [key,value] : map)
+    //Like the standard operator new, calls the installed new_handler until the allocation succeeds, and throws std::bad_alloc
+    //if there is none
+    inline void * countedAllocateOrThrow(   std::size_t size,
+                                            std::size_t alignment   )
+    {
+        void * pointer = rawAllocate(size, alignment);
+        while(pointer == nullptr)
         {
-            //If we find a key greater than the max key, set the max key to the the current pair's key
-            if(key > maxKey)
+            std::new_handler handler = std::get_new_handler();
+            if(handler == nullptr)
             {
-                maxValue = value;
-                maxKey = key;
+                throw std::bad_alloc();
             }
+            handler();
+            pointer = rawAllocate(size, alignment);
         }
+        threadAllocations.allocations++;
+        threadAllocations.bytes += size;
+        return pointer;
+    }
 
-        //Reconstruct the pair we found containing the max key from the map
-        std::pair<K,V> maxPair = std::pair(maxKey, maxValue); 
-        return maxPair;
+    inline void * countedAllocate(  std::size_t size,
+                                    std::size_t alignment   ) noexcept
+    {
+        try
+        {
+            return countedAllocateOrThrow(size, alignment);
+        }
+        catch(...)
+        {
+            return nullptr;
+        }
     }
 
+    static const bool countingAllocatorInstaller = (countingAllocatorInstalled.store(true), true);
+}
 
-};
-#endif
\ No newline at end of file
+void * operator new(    std::size_t size    ) { return stevensMapLib::instrumentation::detail::countedAllocateOrThrow(size, alignof(std::max_align_t)); }
+void * operator new[](  std::size_t size    ) { return stevensMapLib::instrumentation::detail::countedAllocateOrThrow(size, alignof(std::max_align_t)); }
+void * operator new(    std::size_t size, std::align_val_t alignment    ) { return stevensMapLib::instrumentation::detail::countedAllocateOrThrow(size, std::size_t(alignment)); }
+void * operator new[](  std::size_t size, std::align_val_t alignment    ) { return stevensMapLib::instrumentation::detail::countedAllocateOrThrow(size, std::size_t(alignment)); }
+void * operator new(    std::size_t size, const std::nothrow_t &    ) noexcept { return stevensMapLib::instrumentation::detail::countedAllocate(size, alignof(std::max_align_t)); }
+void * operator new[](  std::size_t size, const std::nothrow_t &    ) noexcept { return stevensMapLib::instrumentation::detail::countedAllocate(size, alignof(std::max_align_t)); }
+void * operator new(    std::size_t size, std::align_val_t alignment, const std::nothrow_t &    ) noexcept { return stevensMapLib::instrumentation::detail::countedAllocate(size, std::size_t(alignment)); }
+void * operator new[](  std::size_t size, std::align_val_t alignment, const std::nothrow_t & ) noexcept { return stevensMapLib::instrumentation::detail::countedAllocate(size, std::size_t(alignment)); }
+void operator delete(   void * pointer  ) noexcept { std::free(pointer); }
+void operator delete[]( void * pointer  ) noexcept { std::free(pointer); }
+void operator delete(   void * pointer, std::size_t ) noexcept { std::free(pointer); }
+void operator delete[]( void * pointer, std::size_t ) noexcept { std::free(pointer); }
+void operator delete(   void * pointer, std::align_val_t    ) noexcept { std::free(pointer); }
+void operator delete[]( void * pointer, std::align_val_t    ) noexcept { std::free(pointer); }
+void operator delete(   void * pointer, std::size_t, std::align_val_t   ) noexcept { std::free(pointer); }
+void operator delete[]( void * pointer, std::size_t, std::align_val_t   ) noexcept { std::free(pointer); }
+void operator delete(   void * pointer, const std::nothrow_t &  ) noexcept { std::free(pointer); }
+void operator delete[]( void * pointer, const std::nothrow_t &  ) noexcept { std::free(pointer); }
+void operator delete(   void * pointer, std::align_val_t, const std::nothrow_t &    ) noexcept { std::free(pointer); }
+void operator delete[]( void * pointer, std::align_val_t, const std::nothrow_t &    ) noexcept { std::free(pointer); }
+
+#endif
@@ -0,0 +1,111 @@
+//Checks the library functions listed in stevensMapLib::instrumentation::budgets against their declared allocation budgets,
+//so a change that makes one of them allocate more fails here instead of going unnoticed.
+//
+//Build:  g++ -std=c++20 -O2 -pthread -I.. allocationBudgets.cpp -o allocationBudgets
+//Run:    ./allocationBudgets    (exits with 1 and names each function over budget)
+
+//Replaces the global operator new with the counting one, in this source file only
+#define STEVENSMAPLIB_COUNT_ALLOCATIONS_IMPLEMENTATION
+//Also checks that the instrumentation hooks themselves allocate nothing
+#define STEVENSMAPLIB_INSTRUMENTATION
+#include "stevensMapLib.hpp"
+#include <cstdio>
+#include <map>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+    namespace in = stevensMapLib::instrumentation;
+
+    int failures = 0;
+
+    template <typename Function>
+    void check( const std::string & name,
+                const in::AllocationBudget & budget,
+                Function && function    )
+    {
+        try
+        {
+            in::AllocationStats stats = in::checkAllocationBudget(name, budget, function);
+            std::printf("ok      %-60s %llu allocations, %llu bytes\n", name.c_str(), static_cast<unsigned long long>(stats.allocations), static_cast<unsigned long long>(stats.bytes));
+        }
+        catch(const std::runtime_error & error)
+        {
+            std::printf("FAILED  %s\n", error.what());
+            failures++;
+        }
+    }
+
+    //Runs every budgeted function on one map. Keys and values are numbers or short strings, which copy without allocating
+    template <typename Map>
+    void checkBudgets(  const std::string & mapName,
+                        Map map )
+    {
+        check(mapName + " sumAllValues", in::budgets::sumAllValues, [&]{ return stevensMapLib::sumAllValues(map); });
+        check(mapName + " setNegativeValuesToZero", in::budgets::setNegativeValuesToZero, [&]{ stevensMapLib::setNegativeValuesToZero(map); });
+        check(mapName + " getFirstKey", in::budgets::getFirstKey, [&]{ return stevensMapLib::getFirstKey(map); });
+        check(mapName + " getRandomKey", in::budgets::getRandomKey, [&]{ return stevensMapLib::getRandomKey(map); });
+        check(mapName + " getPairWithMaxValue", in::budgets::getPairWithMaxValue, [&]{ return stevensMapLib::getPairWithMaxValue(map); });
+        check(mapName + " getPairWithMaxKey", in::budgets::getPairWithMaxKey, [&]{ return stevensMapLib::getPairWithMaxKey(map); });
+        check(mapName + " getKeyVector", in::budgets::getKeyVector, [&]{ return stevensMapLib::getKeyVector(map); });
+        check(mapName + " getValueVector", in::budgets::getValueVector, [&]{ return stevensMapLib::getValueVector(map); });
+        check(mapName + " mapToVecOfTuples", in::budgets::mapToVecOfTuples, [&]{ return stevensMapLib::mapToVecOfTuples(map); });
+    }
+
+    //The counting operator new must call the installed new_handler before giving up, like the one it replaces
+    bool newHandlerCalled = false;
+
+    void checkNewHandler()
+    {
+        std::set_new_handler([]
+        {
+            newHandlerCalled = true;
+            std::set_new_handler(nullptr);
+        });
+        bool threw = false;
+        try
+        {
+            //Far more than any machine can provide, so the allocation always fails
+            void * pointer = ::operator new(std::size_t(1) << 62);
+            ::operator delete(pointer);
+        }
+        catch(const std::bad_alloc &)
+        {
+            threw = true;
+        }
+        std::set_new_handler(nullptr);
+        bool passed = threw && newHandlerCalled;
+        std::printf("%s operator new calls the new_handler before throwing std::bad_alloc\n", passed ? "ok     " : "FAILED ");
+        failures += passed ? 0 : 1;
+    }
+}
+
+int main()
+{
+    if(!in::countingAllocatorInstalled())
+    {
+        std::printf("FAILED  the counting allocator is not installed\n");
+        return 1;
+    }
+
+    std::map<int,double> ordered;
+    std::unordered_map<std::string,long> hashed;
+    for(int i = 0; i < 1000; i++)
+    {
+        ordered[i] = i - 500.0;
+        hashed["key" + std::to_string(i)] = i - 500;
+    }
+    checkBudgets("std::map<int,double>", ordered);
+    checkBudgets("std::unordered_map<std::string,long>", hashed);
+    checkNewHandler();
+
+    if(failures > 0)
+    {
+        std::printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}